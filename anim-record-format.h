@@ -0,0 +1,219 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Compact animation record stream (".lyan").
+//
+// The file starts with the 8 byte magic "LYANIM1\n" followed by
+// records.  Every record is a one byte tag and unsigned LEB128 varints:
+//
+//   SYNC  tag 0x06  time(ns) uid            absolute base for what follows
+//   NODE  tag 0x01  node x y                x, y as little-endian doubles
+//   POS   tag 0x05  dt node x y             position change
+//   TX    tag 0x02  dt node duid            first bit of a frame sent
+//   RX    tag 0x03  dt node duid            frame received
+//   DROP  tag 0x04  dt node duid            frame lost at the receiver
+//
+// dt is the time in ns since the previous record and duid the
+// zig-zag coded difference to the previous record's packet uid; both
+// restart from the values of the last SYNC record.  A writer emits a
+// SYNC at the start of every flushed block, so decoding may start at
+// any SYNC.  Nothing in this header depends on ns-3, so the offline
+// tools share it.
+//
+#ifndef LY_ANIM_RECORD_FORMAT_H
+#define LY_ANIM_RECORD_FORMAT_H
+
+#include <stdint.h>
+#include <cstring>
+#include <vector>
+
+namespace ns3 {
+namespace anim {
+
+static const char MAGIC[] = "LYANIM1\n";
+static const uint32_t MAGIC_SIZE = 8;
+
+enum RecordType
+{
+  NODE = 0x01,
+  TX = 0x02,
+  RX = 0x03,
+  DROP = 0x04,
+  POS = 0x05,
+  SYNC = 0x06
+};
+
+/**
+ * One decoded record with absolute time and uid.
+ */
+struct Record
+{
+  uint8_t type;
+  uint64_t timeNs;
+  uint32_t node;
+  uint64_t uid;
+  double x;
+  double y;
+};
+
+inline void
+PutVarint (std::vector<uint8_t> &buf, uint64_t v)
+{
+  while (v >= 0x80)
+    {
+      buf.push_back (static_cast<uint8_t> (v | 0x80));
+      v >>= 7;
+    }
+  buf.push_back (static_cast<uint8_t> (v));
+}
+
+inline void
+PutDouble (std::vector<uint8_t> &buf, double v)
+{
+  uint8_t bytes[8];
+  std::memcpy (bytes, &v, 8);
+  buf.insert (buf.end (), bytes, bytes + 8);
+}
+
+inline uint64_t
+ZigZag (int64_t v)
+{
+  return (static_cast<uint64_t> (v) << 1) ^ static_cast<uint64_t> (v >> 63);
+}
+
+inline int64_t
+UnZigZag (uint64_t v)
+{
+  return static_cast<int64_t> (v >> 1) ^ -static_cast<int64_t> (v & 1);
+}
+
+/**
+ * Sequential decoder over a block of record bytes.
+ */
+class Decoder
+{
+public:
+  Decoder (const uint8_t *begin, const uint8_t *end)
+    : m_p (begin),
+      m_end (end),
+      m_time (0),
+      m_uid (0)
+  {
+  }
+
+  /**
+   * Decode the next record.
+   * \param r the record to fill
+   * \return false at the end of the block or on a truncated record
+   */
+  bool Next (Record &r)
+  {
+    if (m_p >= m_end)
+      {
+        return false;
+      }
+    const uint8_t *start = m_p;
+    r.type = *m_p++;
+    uint64_t v = 0;
+    bool ok = true;
+    switch (r.type)
+      {
+      case SYNC:
+        ok = GetVarint (m_time) && GetVarint (m_uid);
+        r.timeNs = m_time;
+        r.uid = m_uid;
+        break;
+      case NODE:
+        ok = GetVarint (v) && GetDouble (r.x) && GetDouble (r.y);
+        r.node = static_cast<uint32_t> (v);
+        r.timeNs = m_time;
+        break;
+      case POS:
+        ok = GetVarint (v);
+        m_time += v;
+        ok = ok && GetVarint (v) && GetDouble (r.x) && GetDouble (r.y);
+        r.node = static_cast<uint32_t> (v);
+        r.timeNs = m_time;
+        break;
+      case TX:
+      case RX:
+      case DROP:
+        ok = GetVarint (v);
+        m_time += v;
+        ok = ok && GetVarint (v);
+        r.node = static_cast<uint32_t> (v);
+        ok = ok && GetVarint (v);
+        m_uid += UnZigZag (v);
+        r.timeNs = m_time;
+        r.uid = m_uid;
+        break;
+      default:
+        ok = false;
+        break;
+      }
+    if (!ok)
+      {
+        m_p = start;
+        m_end = start;
+      }
+    return ok;
+  }
+
+  /// \return the current read position
+  const uint8_t *Position (void) const
+  {
+    return m_p;
+  }
+
+private:
+  bool GetVarint (uint64_t &v)
+  {
+    v = 0;
+    for (uint32_t shift = 0; m_p < m_end && shift < 64; shift += 7)
+      {
+        uint8_t b = *m_p++;
+        v |= static_cast<uint64_t> (b & 0x7f) << shift;
+        if (!(b & 0x80))
+          {
+            return true;
+          }
+      }
+    return false;
+  }
+
+  bool GetDouble (double &v)
+  {
+    if (m_end - m_p < 8)
+      {
+        return false;
+      }
+    std::memcpy (&v, m_p, 8);
+    m_p += 8;
+    return true;
+  }
+
+  const uint8_t *m_p;
+  const uint8_t *m_end;
+  uint64_t m_time;
+  uint64_t m_uid;
+};
+
+} // namespace anim
+} // namespace ns3
+
+#endif /* LY_ANIM_RECORD_FORMAT_H */
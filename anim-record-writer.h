@@ -0,0 +1,533 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Streaming writer for the compact animation record format described in
+// anim-record-format.h, a replacement for the NetAnim XML of
+// AnimationInterface on large runs.
+//
+// Records are encoded into one fixed-size block that is written out when
+// it fills up and every flush interval of simulated time, so memory use
+// does not grow with the run.  Frames can be restricted to a set of
+// nodes and/or to the frames of some IP flows.  Use
+// ly2017210600AnimConvert to turn the stream into NetAnim XML.
+//
+// The stream can be split into segment files, "<base>-000.lyan",
+// "<base>-001.lyan", ..., one per window of simulated time and/or once a
+// segment reaches a size.  Every segment starts with a block holding the
+// node table, so it decodes on its own.  The text index "<base>.lyidx"
+// lists the segments and every block written:
+//
+//   segment <n> <file>
+//   block <segment> <offset> <bytes> <first ns> <last ns>
+//
+// so a reader interested in t = 29..31 s only seeks to the blocks of
+// that window.
+//
+#ifndef LY_ANIM_RECORD_WRITER_H
+#define LY_ANIM_RECORD_WRITER_H
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ns3/abort.h"
+#include "ns3/callback.h"
+#include "ns3/simulator.h"
+#include "ns3/nstime.h"
+#include "ns3/node-container.h"
+#include "ns3/mobility-model.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/wifi-phy.h"
+#include "ns3/wifi-mac-header.h"
+#include "ns3/llc-snap-header.h"
+#include "ns3/ipv4-header.h"
+#include "anim-record-format.h"
+
+namespace ns3 {
+
+/**
+ * Writes wifi frame tx/rx/drop records and node positions as a compact
+ * binary stream.
+ */
+class AnimRecordWriter
+{
+public:
+  AnimRecordWriter ();
+  ~AnimRecordWriter ();
+
+  /**
+   * Start a new segment every window of simulated time and/or when a
+   * segment exceeds a size.  Call before Open.
+   * \param window segment length in simulated time, zero for no limit
+   * \param maxBytes segment size, zero for no limit
+   */
+  void SetRotation (Time window, uint64_t maxBytes);
+  /**
+   * \param base output name without extension; the stream goes to
+   *        "<base>.lyan" (or numbered segments when rotating) and the
+   *        index to "<base>.lyidx"
+   */
+  void Open (std::string base);
+  /**
+   * \param interval simulated time between forced flushes
+   */
+  void SetFlushInterval (Time interval);
+  /**
+   * \param bytes size of the in-memory block
+   */
+  void SetBlockSize (uint32_t bytes);
+  /**
+   * Only record frames sent or received by these nodes.
+   * \param list node ids and ranges, e.g. "0-9,90-99"
+   * \param numNodes nodes in the scenario
+   */
+  void SetNodeFilter (std::string list, uint32_t numNodes);
+  /**
+   * Only record data frames of this IP flow (may be called for several
+   * flows).
+   */
+  void AddFlowFilter (Ipv4Address src, Ipv4Address dst);
+
+  /**
+   * Write the node table and connect to the PHY and mobility traces of
+   * every node.  Call after devices and mobility are installed.
+   */
+  void Install (NodeContainer nodes);
+  /// Write out what is buffered and close the file.
+  void Close (void);
+
+  uint64_t GetBytesWritten (void) const;
+
+  /**
+   * Parse a node list such as "0-9,90-99".
+   * \param list the list
+   * \param numNodes nodes in the scenario
+   * \return one flag per node
+   */
+  static std::vector<bool> ParseNodeList (std::string list, uint32_t numNodes);
+
+private:
+  bool Accept (uint32_t node, Ptr<const Packet> packet) const;
+  void Append (uint8_t type, uint32_t node, uint64_t uid);
+  void AppendPosition (uint32_t node, const Vector &position);
+  void BeginBlock (void);
+  void OpenSegment (void);
+  void WriteNodeTable (void);
+  void MaybeRotate (void);
+  void Flush (void);
+  void PeriodicFlush (void);
+
+  static void TxSink (AnimRecordWriter *writer, uint32_t node, Ptr<const Packet> packet,
+                      uint16_t channelFreqMhz, WifiTxVector txVector, MpduInfo aMpdu);
+  static void RxSink (AnimRecordWriter *writer, uint32_t node, Ptr<const Packet> packet,
+                      uint16_t channelFreqMhz, WifiTxVector txVector, MpduInfo aMpdu,
+                      SignalNoiseDbm signalNoise);
+  static void DropSink (AnimRecordWriter *writer, uint32_t node, Ptr<const Packet> packet);
+  static void CourseChangeSink (AnimRecordWriter *writer, uint32_t node,
+                                Ptr<const MobilityModel> mobility);
+
+  FILE *m_file;
+  FILE *m_index;
+  std::string m_base;
+  Time m_window;
+  uint64_t m_maxBytes;
+  uint32_t m_segment;
+  uint64_t m_segmentBytes;
+  uint64_t m_segmentEnd;
+  NodeContainer m_installed;
+  std::vector<uint8_t> m_block;
+  uint64_t m_blockFirstTime;
+  uint32_t m_blockSize;
+  Time m_flushInterval;
+  EventId m_flushEvent;
+  uint64_t m_lastTime;
+  uint64_t m_lastUid;
+  uint64_t m_bytesWritten;
+  std::vector<bool> m_nodes;
+  std::set<std::pair<uint32_t, uint32_t> > m_flows;
+};
+
+AnimRecordWriter::AnimRecordWriter ()
+  : m_file (0),
+    m_index (0),
+    m_window (Seconds (0)),
+    m_maxBytes (0),
+    m_segment (0),
+    m_segmentBytes (0),
+    m_segmentEnd (0),
+    m_blockFirstTime (0),
+    m_blockSize (64 * 1024),
+    m_flushInterval (Seconds (1.0)),
+    m_lastTime (0),
+    m_lastUid (0),
+    m_bytesWritten (0)
+{
+}
+
+AnimRecordWriter::~AnimRecordWriter ()
+{
+  Close ();
+}
+
+void
+AnimRecordWriter::SetRotation (Time window, uint64_t maxBytes)
+{
+  m_window = window;
+  m_maxBytes = maxBytes;
+}
+
+void
+AnimRecordWriter::Open (std::string base)
+{
+  Close ();
+  m_base = base;
+  m_segment = 0;
+  m_index = std::fopen ((base + ".lyidx").c_str (), "w");
+  NS_ABORT_MSG_IF (m_index == 0, "Cannot open " << base << ".lyidx: " << std::strerror (errno));
+  m_block.clear ();
+  m_block.reserve (m_blockSize + 64);
+  OpenSegment ();
+}
+
+void
+AnimRecordWriter::OpenSegment (void)
+{
+  std::ostringstream name;
+  name << m_base;
+  if (m_window.IsStrictlyPositive () || m_maxBytes > 0)
+    {
+      name << "-" << std::setw (3) << std::setfill ('0') << m_segment;
+    }
+  name << ".lyan";
+  m_file = std::fopen (name.str ().c_str (), "wb");
+  NS_ABORT_MSG_IF (m_file == 0, "Cannot open " << name.str () << ": " << std::strerror (errno));
+  std::fwrite (anim::MAGIC, 1, anim::MAGIC_SIZE, m_file);
+  m_bytesWritten += anim::MAGIC_SIZE;
+  m_segmentBytes = anim::MAGIC_SIZE;
+  std::fprintf (m_index, "segment %u %s\n", m_segment, name.str ().c_str ());
+
+  uint64_t now = Simulator::Now ().GetNanoSeconds ();
+  if (m_window.IsStrictlyPositive ())
+    {
+      uint64_t window = m_window.GetNanoSeconds ();
+      m_segmentEnd = (now / window + 1) * window;
+    }
+  // Later segments repeat the node table with the current positions.
+  if (m_installed.GetN () > 0)
+    {
+      WriteNodeTable ();
+    }
+}
+
+void
+AnimRecordWriter::WriteNodeTable (void)
+{
+  BeginBlock ();
+  for (NodeContainer::Iterator it = m_installed.Begin (); it != m_installed.End (); ++it)
+    {
+      Ptr<MobilityModel> mobility = (*it)->GetObject<MobilityModel> ();
+      if (mobility != 0)
+        {
+          Vector position = mobility->GetPosition ();
+          m_block.push_back (anim::NODE);
+          anim::PutVarint (m_block, (*it)->GetId ());
+          anim::PutDouble (m_block, position.x);
+          anim::PutDouble (m_block, position.y);
+        }
+    }
+  Flush ();
+}
+
+void
+AnimRecordWriter::MaybeRotate (void)
+{
+  bool timeUp = m_window.IsStrictlyPositive ()
+    && static_cast<uint64_t> (Simulator::Now ().GetNanoSeconds ()) >= m_segmentEnd;
+  bool full = m_maxBytes > 0 && m_segmentBytes >= m_maxBytes;
+  if (!timeUp && !full)
+    {
+      return;
+    }
+  Flush ();
+  std::fclose (m_file);
+  ++m_segment;
+  OpenSegment ();
+}
+
+void
+AnimRecordWriter::SetFlushInterval (Time interval)
+{
+  m_flushInterval = interval;
+}
+
+void
+AnimRecordWriter::SetBlockSize (uint32_t bytes)
+{
+  m_blockSize = bytes;
+  m_block.reserve (m_blockSize + 64);
+}
+
+std::vector<bool>
+AnimRecordWriter::ParseNodeList (std::string list, uint32_t numNodes)
+{
+  std::vector<bool> nodes (numNodes, false);
+  std::istringstream items (list);
+  std::string item;
+  while (std::getline (items, item, ','))
+    {
+      if (item.empty ())
+        {
+          continue;
+        }
+      std::string::size_type dash = item.find ('-');
+      uint32_t first = std::atoi (item.c_str ());
+      uint32_t last = dash == std::string::npos ? first : std::atoi (item.c_str () + dash + 1);
+      NS_ABORT_MSG_IF (first > last || last >= numNodes, "Bad node range \"" << item << "\"");
+      for (uint32_t n = first; n <= last; ++n)
+        {
+          nodes[n] = true;
+        }
+    }
+  return nodes;
+}
+
+void
+AnimRecordWriter::SetNodeFilter (std::string list, uint32_t numNodes)
+{
+  m_nodes = ParseNodeList (list, numNodes);
+}
+
+void
+AnimRecordWriter::AddFlowFilter (Ipv4Address src, Ipv4Address dst)
+{
+  m_flows.insert (std::make_pair (src.Get (), dst.Get ()));
+}
+
+void
+AnimRecordWriter::Install (NodeContainer nodes)
+{
+  NS_ABORT_MSG_IF (m_file == 0, "AnimRecordWriter::Install before Open");
+  m_installed = nodes;
+  WriteNodeTable ();
+  for (NodeContainer::Iterator it = nodes.Begin (); it != nodes.End (); ++it)
+    {
+      Ptr<Node> node = *it;
+      uint32_t id = node->GetId ();
+      Ptr<MobilityModel> mobility = node->GetObject<MobilityModel> ();
+      if (mobility != 0)
+        {
+          mobility->TraceConnectWithoutContext
+            ("CourseChange", MakeBoundCallback (&AnimRecordWriter::CourseChangeSink, this, id));
+        }
+      for (uint32_t d = 0; d < node->GetNDevices (); ++d)
+        {
+          Ptr<WifiNetDevice> device = DynamicCast<WifiNetDevice> (node->GetDevice (d));
+          if (device == 0)
+            {
+              continue;
+            }
+          Ptr<WifiPhy> phy = device->GetPhy ();
+          phy->TraceConnectWithoutContext
+            ("MonitorSnifferTx", MakeBoundCallback (&AnimRecordWriter::TxSink, this, id));
+          phy->TraceConnectWithoutContext
+            ("MonitorSnifferRx", MakeBoundCallback (&AnimRecordWriter::RxSink, this, id));
+          phy->TraceConnectWithoutContext
+            ("PhyRxDrop", MakeBoundCallback (&AnimRecordWriter::DropSink, this, id));
+        }
+    }
+  m_flushEvent = Simulator::Schedule (m_flushInterval, &AnimRecordWriter::PeriodicFlush, this);
+}
+
+void
+AnimRecordWriter::Close (void)
+{
+  if (m_file == 0)
+    {
+      return;
+    }
+  m_flushEvent.Cancel ();
+  Flush ();
+  std::fclose (m_file);
+  m_file = 0;
+  std::fclose (m_index);
+  m_index = 0;
+}
+
+uint64_t
+AnimRecordWriter::GetBytesWritten (void) const
+{
+  return m_bytesWritten;
+}
+
+bool
+AnimRecordWriter::Accept (uint32_t node, Ptr<const Packet> packet) const
+{
+  if (!m_nodes.empty () && (node >= m_nodes.size () || !m_nodes[node]))
+    {
+      return false;
+    }
+  if (m_flows.empty ())
+    {
+      return true;
+    }
+  // Only data frames carrying IPv4 can belong to a flow.
+  Ptr<Packet> copy = packet->Copy ();
+  WifiMacHeader mac;
+  if (copy->RemoveHeader (mac) == 0 || !mac.IsData ())
+    {
+      return false;
+    }
+  LlcSnapHeader llc;
+  if (copy->RemoveHeader (llc) == 0 || llc.GetType () != 0x0800)
+    {
+      return false;
+    }
+  Ipv4Header ip;
+  copy->PeekHeader (ip);
+  return m_flows.find (std::make_pair (ip.GetSource ().Get (),
+                                       ip.GetDestination ().Get ())) != m_flows.end ();
+}
+
+void
+AnimRecordWriter::BeginBlock (void)
+{
+  if (!m_block.empty ())
+    {
+      return;
+    }
+  m_lastTime = Simulator::Now ().GetNanoSeconds ();
+  m_blockFirstTime = m_lastTime;
+  m_block.push_back (anim::SYNC);
+  anim::PutVarint (m_block, m_lastTime);
+  anim::PutVarint (m_block, m_lastUid);
+}
+
+void
+AnimRecordWriter::Append (uint8_t type, uint32_t node, uint64_t uid)
+{
+  MaybeRotate ();
+  BeginBlock ();
+  uint64_t now = Simulator::Now ().GetNanoSeconds ();
+  m_block.push_back (type);
+  anim::PutVarint (m_block, now - m_lastTime);
+  anim::PutVarint (m_block, node);
+  anim::PutVarint (m_block, anim::ZigZag (static_cast<int64_t> (uid - m_lastUid)));
+  m_lastTime = now;
+  m_lastUid = uid;
+  if (m_block.size () >= m_blockSize)
+    {
+      Flush ();
+    }
+}
+
+void
+AnimRecordWriter::AppendPosition (uint32_t node, const Vector &position)
+{
+  MaybeRotate ();
+  BeginBlock ();
+  uint64_t now = Simulator::Now ().GetNanoSeconds ();
+  m_block.push_back (anim::POS);
+  anim::PutVarint (m_block, now - m_lastTime);
+  anim::PutVarint (m_block, node);
+  anim::PutDouble (m_block, position.x);
+  anim::PutDouble (m_block, position.y);
+  m_lastTime = now;
+  if (m_block.size () >= m_blockSize)
+    {
+      Flush ();
+    }
+}
+
+void
+AnimRecordWriter::Flush (void)
+{
+  if (m_file == 0 || m_block.empty ())
+    {
+      return;
+    }
+  size_t n = std::fwrite (&m_block[0], 1, m_block.size (), m_file);
+  NS_ABORT_MSG_IF (n != m_block.size (), "Short write on animation stream");
+  std::fflush (m_file);
+  std::fprintf (m_index, "block %u %llu %llu %llu %llu\n", m_segment,
+                static_cast<unsigned long long> (m_segmentBytes),
+                static_cast<unsigned long long> (n),
+                static_cast<unsigned long long> (m_blockFirstTime),
+                static_cast<unsigned long long> (m_lastTime));
+  std::fflush (m_index);
+  m_bytesWritten += n;
+  m_segmentBytes += n;
+  m_block.clear ();
+}
+
+void
+AnimRecordWriter::PeriodicFlush (void)
+{
+  Flush ();
+  m_flushEvent = Simulator::Schedule (m_flushInterval, &AnimRecordWriter::PeriodicFlush, this);
+}
+
+void
+AnimRecordWriter::TxSink (AnimRecordWriter *writer, uint32_t node, Ptr<const Packet> packet,
+                          uint16_t channelFreqMhz, WifiTxVector txVector, MpduInfo aMpdu)
+{
+  if (writer->Accept (node, packet))
+    {
+      writer->Append (anim::TX, node, packet->GetUid ());
+    }
+}
+
+void
+AnimRecordWriter::RxSink (AnimRecordWriter *writer, uint32_t node, Ptr<const Packet> packet,
+                          uint16_t channelFreqMhz, WifiTxVector txVector, MpduInfo aMpdu,
+                          SignalNoiseDbm signalNoise)
+{
+  if (writer->Accept (node, packet))
+    {
+      writer->Append (anim::RX, node, packet->GetUid ());
+    }
+}
+
+void
+AnimRecordWriter::DropSink (AnimRecordWriter *writer, uint32_t node, Ptr<const Packet> packet)
+{
+  if (writer->Accept (node, packet))
+    {
+      writer->Append (anim::DROP, node, packet->GetUid ());
+    }
+}
+
+void
+AnimRecordWriter::CourseChangeSink (AnimRecordWriter *writer, uint32_t node,
+                                    Ptr<const MobilityModel> mobility)
+{
+  if (writer->m_nodes.empty () || (node < writer->m_nodes.size () && writer->m_nodes[node]))
+    {
+      writer->AppendPosition (node, mobility->GetPosition ());
+    }
+}
+
+} // namespace ns3
+
+#endif /* LY_ANIM_RECORD_WRITER_H */
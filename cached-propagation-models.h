@@ -0,0 +1,361 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Propagation loss and delay models that remember their result for
+// node pairs that do not move.
+//
+// A pair is cached once both of its mobility models report a zero
+// velocity.  Every mobility model of a cached pair is watched: its
+// CourseChange (a move by hand, or a walk starting) drops all of its
+// pairs.  Pairs are keyed symmetrically, so a->b and b->a share an
+// entry, and pairs farther apart than SetMaxDistance() are recomputed
+// instead of stored.  Combined with GridYansWifiChannel, which never
+// asks for pairs beyond detection range, only in-range pairs are kept;
+// a YansWifiChannel asks for every pair, so give it the detection range
+// (GridYansWifiChannel::FriisRange) as the maximum distance.
+//
+// The wrapped models must be deterministic and, for the loss, add a
+// power-independent gain: Friis, LogDistance, ThreeLogDistance, ...
+// The loss is cached as inner->CalcRxPower (0, a, b) and returned as
+// txPowerDbm + gain, the same double Friis computes itself.
+//
+#ifndef LY_CACHED_PROPAGATION_MODELS_H
+#define LY_CACHED_PROPAGATION_MODELS_H
+
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+
+#include "ns3/abort.h"
+#include "ns3/callback.h"
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+#include "ns3/mobility-model.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/propagation-delay-model.h"
+
+namespace ns3 {
+
+/**
+ * Symmetric cache of one value per pair of static mobility models.
+ */
+template <typename T>
+class StaticPairCache
+{
+public:
+  StaticPairCache ()
+    : m_maxDistance (0),
+      m_hits (0),
+      m_misses (0)
+  {
+  }
+
+  /// \param distance pairs farther apart are not stored; 0 = no limit
+  void SetMaxDistance (double distance)
+  {
+    m_maxDistance = distance;
+  }
+
+  /**
+   * \param a one end
+   * \param b the other end
+   * \param value set to the cached value on a hit
+   * \return true on a hit
+   */
+  bool Lookup (Ptr<MobilityModel> a, Ptr<MobilityModel> b, T &value)
+  {
+    typename std::unordered_map<uint64_t, T>::const_iterator it = m_values.find (Key (a, b));
+    if (it == m_values.end ())
+      {
+        ++m_misses;
+        return false;
+      }
+    ++m_hits;
+    value = it->second;
+    return true;
+  }
+
+  /**
+   * Remember the value of a pair if both ends stand still.
+   */
+  void Store (Ptr<MobilityModel> a, Ptr<MobilityModel> b, const T &value)
+  {
+    if (!IsStatic (a) || !IsStatic (b)
+        || (m_maxDistance > 0 && a->GetDistanceFrom (b) > m_maxDistance))
+      {
+        return;
+      }
+    uint32_t sa = Slot (a);
+    uint32_t sb = Slot (b);
+    m_values[PairKey (sa, sb)] = value;
+    m_partners[sa].push_back (sb);
+    m_partners[sb].push_back (sa);
+  }
+
+  uint64_t GetHits (void) const
+  {
+    return m_hits;
+  }
+
+  uint64_t GetMisses (void) const
+  {
+    return m_misses;
+  }
+
+  size_t GetSize (void) const
+  {
+    return m_values.size ();
+  }
+
+private:
+  static bool IsStatic (Ptr<MobilityModel> m)
+  {
+    Vector v = m->GetVelocity ();
+    return v.x == 0 && v.y == 0 && v.z == 0;
+  }
+
+  static uint64_t PairKey (uint32_t a, uint32_t b)
+  {
+    return a < b ? (static_cast<uint64_t> (a) << 32) | b : (static_cast<uint64_t> (b) << 32) | a;
+  }
+
+  /// \return the pair key, or one no pair uses if an end is unknown
+  uint64_t Key (Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+  {
+    std::unordered_map<const MobilityModel *, uint32_t>::const_iterator ia = m_slots.find (PeekPointer (a));
+    std::unordered_map<const MobilityModel *, uint32_t>::const_iterator ib = m_slots.find (PeekPointer (b));
+    if (ia == m_slots.end () || ib == m_slots.end ())
+      {
+        return ~static_cast<uint64_t> (0);
+      }
+    return PairKey (ia->second, ib->second);
+  }
+
+  uint32_t Slot (Ptr<MobilityModel> m)
+  {
+    std::pair<std::unordered_map<const MobilityModel *, uint32_t>::iterator, bool> inserted =
+      m_slots.insert (std::make_pair (PeekPointer (m), static_cast<uint32_t> (m_partners.size ())));
+    if (inserted.second)
+      {
+        m_partners.push_back (std::vector<uint32_t> ());
+        m->TraceConnectWithoutContext
+          ("CourseChange", MakeCallback (&StaticPairCache<T>::CourseChanged, this));
+      }
+    return inserted.first->second;
+  }
+
+  void CourseChanged (Ptr<const MobilityModel> m)
+  {
+    std::unordered_map<const MobilityModel *, uint32_t>::const_iterator it = m_slots.find (PeekPointer (m));
+    if (it == m_slots.end ())
+      {
+        return;
+      }
+    uint32_t s = it->second;
+    for (uint32_t k = 0; k < m_partners[s].size (); ++k)
+      {
+        m_values.erase (PairKey (s, m_partners[s][k]));
+      }
+    m_partners[s].clear ();
+  }
+
+  std::unordered_map<const MobilityModel *, uint32_t> m_slots;
+  std::vector<std::vector<uint32_t> > m_partners;  //!< cached partners of every slot
+  std::unordered_map<uint64_t, T> m_values;
+  double m_maxDistance;
+  uint64_t m_hits;
+  uint64_t m_misses;
+};
+
+/**
+ * Caches the gain of a deterministic loss model for static pairs.
+ */
+class CachedPropagationLossModel : public PropagationLossModel
+{
+public:
+  static TypeId GetTypeId (void);
+
+  CachedPropagationLossModel ();
+  virtual ~CachedPropagationLossModel ();
+
+  void SetInner (Ptr<PropagationLossModel> inner);
+  Ptr<PropagationLossModel> GetInner (void) const;
+  StaticPairCache<double> &GetCache (void);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  virtual double DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a,
+                                Ptr<MobilityModel> b) const;
+  virtual int64_t DoAssignStreams (int64_t stream);
+
+  Ptr<PropagationLossModel> m_inner;
+  mutable StaticPairCache<double> m_cache;
+};
+
+/**
+ * Caches the delay of a deterministic delay model for static pairs.
+ */
+class CachedPropagationDelayModel : public PropagationDelayModel
+{
+public:
+  static TypeId GetTypeId (void);
+
+  CachedPropagationDelayModel ();
+  virtual ~CachedPropagationDelayModel ();
+
+  void SetInner (Ptr<PropagationDelayModel> inner);
+  StaticPairCache<Time> &GetCache (void);
+
+  virtual Time GetDelay (Ptr<MobilityModel> a, Ptr<MobilityModel> b) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  virtual int64_t DoAssignStreams (int64_t stream);
+
+  Ptr<PropagationDelayModel> m_inner;
+  mutable StaticPairCache<Time> m_cache;
+};
+
+TypeId
+CachedPropagationLossModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CachedPropagationLossModel")
+    .SetParent<PropagationLossModel> ()
+    .SetGroupName ("Propagation")
+    .AddConstructor<CachedPropagationLossModel> ()
+  ;
+  return tid;
+}
+
+CachedPropagationLossModel::CachedPropagationLossModel ()
+{
+}
+
+CachedPropagationLossModel::~CachedPropagationLossModel ()
+{
+}
+
+void
+CachedPropagationLossModel::DoDispose (void)
+{
+  m_inner = 0;
+  PropagationLossModel::DoDispose ();
+}
+
+void
+CachedPropagationLossModel::SetInner (Ptr<PropagationLossModel> inner)
+{
+  m_inner = inner;
+}
+
+Ptr<PropagationLossModel>
+CachedPropagationLossModel::GetInner (void) const
+{
+  return m_inner;
+}
+
+StaticPairCache<double> &
+CachedPropagationLossModel::GetCache (void)
+{
+  return m_cache;
+}
+
+double
+CachedPropagationLossModel::DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a,
+                                           Ptr<MobilityModel> b) const
+{
+  NS_ABORT_MSG_IF (m_inner == 0, "CachedPropagationLossModel without an inner model");
+  double gain;
+  if (!m_cache.Lookup (a, b, gain))
+    {
+      gain = m_inner->CalcRxPower (0.0, a, b);
+      m_cache.Store (a, b, gain);
+    }
+  return txPowerDbm + gain;
+}
+
+int64_t
+CachedPropagationLossModel::DoAssignStreams (int64_t stream)
+{
+  return m_inner != 0 ? m_inner->AssignStreams (stream) : 0;
+}
+
+TypeId
+CachedPropagationDelayModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CachedPropagationDelayModel")
+    .SetParent<PropagationDelayModel> ()
+    .SetGroupName ("Propagation")
+    .AddConstructor<CachedPropagationDelayModel> ()
+  ;
+  return tid;
+}
+
+CachedPropagationDelayModel::CachedPropagationDelayModel ()
+{
+}
+
+CachedPropagationDelayModel::~CachedPropagationDelayModel ()
+{
+}
+
+void
+CachedPropagationDelayModel::DoDispose (void)
+{
+  m_inner = 0;
+  PropagationDelayModel::DoDispose ();
+}
+
+void
+CachedPropagationDelayModel::SetInner (Ptr<PropagationDelayModel> inner)
+{
+  m_inner = inner;
+}
+
+StaticPairCache<Time> &
+CachedPropagationDelayModel::GetCache (void)
+{
+  return m_cache;
+}
+
+Time
+CachedPropagationDelayModel::GetDelay (Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+{
+  NS_ABORT_MSG_IF (m_inner == 0, "CachedPropagationDelayModel without an inner model");
+  Time delay;
+  if (!m_cache.Lookup (a, b, delay))
+    {
+      delay = m_inner->GetDelay (a, b);
+      m_cache.Store (a, b, delay);
+    }
+  return delay;
+}
+
+int64_t
+CachedPropagationDelayModel::DoAssignStreams (int64_t stream)
+{
+  return m_inner != 0 ? m_inner->AssignStreams (stream) : 0;
+}
+
+} // namespace ns3
+
+#endif /* LY_CACHED_PROPAGATION_MODELS_H */
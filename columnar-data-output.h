@@ -0,0 +1,199 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// DataOutputInterface writing the DataCollector results as one
+// columnar chunk (see columnar-stats-format.h) to "<prefix>.lycol".
+// ly2017210600StatsRead loads thousands of such files into one table.
+//
+#ifndef LY_COLUMNAR_DATA_OUTPUT_H
+#define LY_COLUMNAR_DATA_OUTPUT_H
+
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "ns3/log.h"
+#include "ns3/nstime.h"
+#include "ns3/stats-module.h"
+
+#include "columnar-stats-format.h"
+
+namespace ns3 {
+
+/**
+ * Writes a run's metadata and calculator output as a typed columnar
+ * chunk.
+ */
+class ColumnarDataOutput : public DataOutputInterface
+{
+public:
+  static TypeId GetTypeId (void);
+
+  ColumnarDataOutput ();
+  virtual ~ColumnarDataOutput ();
+
+  virtual void Output (DataCollector &dc);
+
+private:
+  /**
+   * Turns every value a DataCalculator reports into rows of the chunk.
+   */
+  class ColumnarOutputCallback : public DataOutputCallback
+  {
+  public:
+    ColumnarOutputCallback (colstats::ChunkBuilder *chunk);
+
+    void OutputStatistic (std::string context, std::string name,
+                          const StatisticalSummary *statSum);
+    void OutputSingleton (std::string context, std::string name, int val);
+    void OutputSingleton (std::string context, std::string name, uint32_t val);
+    void OutputSingleton (std::string context, std::string name, double val);
+    void OutputSingleton (std::string context, std::string name, std::string val);
+    void OutputSingleton (std::string context, std::string name, Time val);
+
+  private:
+    void Field (const std::string &context, const std::string &name,
+                const std::string &field, double value);
+
+    colstats::ChunkBuilder *m_chunk;
+  };
+};
+
+TypeId
+ColumnarDataOutput::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ColumnarDataOutput")
+    .SetParent<DataOutputInterface> ()
+    .SetGroupName ("Stats")
+    .AddConstructor<ColumnarDataOutput> ()
+  ;
+  return tid;
+}
+
+ColumnarDataOutput::ColumnarDataOutput ()
+{
+  m_filePrefix = "data";
+}
+
+ColumnarDataOutput::~ColumnarDataOutput ()
+{
+}
+
+void
+ColumnarDataOutput::Output (DataCollector &dc)
+{
+  colstats::ChunkBuilder chunk;
+  chunk.AddAttribute ("experiment", dc.GetExperimentLabel ());
+  chunk.AddAttribute ("strategy", dc.GetStrategyLabel ());
+  chunk.AddAttribute ("input", dc.GetInputLabel ());
+  chunk.AddAttribute ("run", dc.GetRunLabel ());
+  chunk.AddAttribute ("description", dc.GetDescription ());
+  for (MetadataList::iterator i = dc.MetadataBegin (); i != dc.MetadataEnd (); ++i)
+    {
+      chunk.AddAttribute (i->first, i->second);
+    }
+
+  ColumnarOutputCallback callback (&chunk);
+  for (DataCalculatorList::iterator i = dc.DataCalculatorBegin ();
+       i != dc.DataCalculatorEnd (); ++i)
+    {
+      (*i)->Output (callback);
+    }
+
+  std::vector<uint8_t> bytes;
+  chunk.Serialize (bytes);
+  std::string fn = m_filePrefix + ".lycol";
+  std::ofstream file (fn.c_str (), std::ios::binary | std::ios::trunc);
+  file.write (reinterpret_cast<const char *> (&bytes[0]), bytes.size ());
+  file.close ();
+  if (!file)
+    {
+      NS_LOG_UNCOND ("Could not write " << fn);
+    }
+}
+
+ColumnarDataOutput::ColumnarOutputCallback::ColumnarOutputCallback (colstats::ChunkBuilder *chunk)
+  : m_chunk (chunk)
+{
+}
+
+void
+ColumnarDataOutput::ColumnarOutputCallback::Field (const std::string &context, const std::string &name,
+                                                   const std::string &field, double value)
+{
+  // same NaN rule as the omnet writer: undefined fields are left out
+  if (!std::isnan (value))
+    {
+      m_chunk->AddRow (colstats::STAT, context, name, field, value);
+    }
+}
+
+void
+ColumnarDataOutput::ColumnarOutputCallback::OutputStatistic (std::string context, std::string name,
+                                                             const StatisticalSummary *statSum)
+{
+  Field (context, name, "count", statSum->getCount ());
+  Field (context, name, "sum", statSum->getSum ());
+  Field (context, name, "mean", statSum->getMean ());
+  Field (context, name, "min", statSum->getMin ());
+  Field (context, name, "max", statSum->getMax ());
+  Field (context, name, "sqrsum", statSum->getSqrSum ());
+  Field (context, name, "stddev", statSum->getStddev ());
+}
+
+void
+ColumnarDataOutput::ColumnarOutputCallback::OutputSingleton (std::string context, std::string name,
+                                                             int val)
+{
+  m_chunk->AddRow (colstats::INT, context, name, "", val);
+}
+
+void
+ColumnarDataOutput::ColumnarOutputCallback::OutputSingleton (std::string context, std::string name,
+                                                             uint32_t val)
+{
+  m_chunk->AddRow (colstats::UINT, context, name, "", val);
+}
+
+void
+ColumnarDataOutput::ColumnarOutputCallback::OutputSingleton (std::string context, std::string name,
+                                                             double val)
+{
+  m_chunk->AddRow (colstats::DOUBLE, context, name, "", val);
+}
+
+void
+ColumnarDataOutput::ColumnarOutputCallback::OutputSingleton (std::string context, std::string name,
+                                                             std::string val)
+{
+  m_chunk->AddRow (colstats::STRING, context, name, "",
+                   std::numeric_limits<double>::quiet_NaN (), m_chunk->Intern (val));
+}
+
+void
+ColumnarDataOutput::ColumnarOutputCallback::OutputSingleton (std::string context, std::string name,
+                                                             Time val)
+{
+  m_chunk->AddRow (colstats::TIME, context, name, "", val.GetNanoSeconds ());
+}
+
+} // namespace ns3
+
+#endif /* LY_COLUMNAR_DATA_OUTPUT_H */
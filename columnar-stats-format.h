@@ -0,0 +1,349 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Columnar statistics file (".lycol").
+//
+// A file is a sequence of self-contained chunks, one per run, so the
+// output of many runs can be concatenated.  All integers are
+// little-endian and every section starts on an 8 byte boundary:
+//
+//   magic     "LYCOL1\n\0"
+//   u64       chunk size in bytes, header included
+//   u32 x 4   strings, attributes, rows, reserved
+//   u32       string offsets [strings + 1] into the string bytes
+//   u8        string bytes
+//   u32       attribute keys [attributes], attribute values [attributes]
+//   f64       value   [rows]
+//   u32       context [rows]  string id
+//   u32       name    [rows]  string id
+//   u32       field   [rows]  string id, "" for singletons
+//   u32       text    [rows]  string id of string values, else NONE
+//   u8        type    [rows]  ValueType
+//
+// Attributes hold the run description (experiment, strategy, input,
+// run, description) followed by the run metadata.  Statistics become
+// one row per field (count, sum, mean, min, max, sqrsum, stddev), as
+// in the omnet writer.  Nothing in this header depends on ns-3, so the
+// offline tools share it.
+//
+#ifndef LY_COLUMNAR_STATS_FORMAT_H
+#define LY_COLUMNAR_STATS_FORMAT_H
+
+#include <stdint.h>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+namespace colstats {
+
+static const char MAGIC[] = "LYCOL1\n";
+static const uint32_t MAGIC_SIZE = 8;
+static const uint32_t HEADER_SIZE = 32;
+static const uint32_t NONE = 0xffffffff;
+
+enum ValueType
+{
+  INT = 1,
+  UINT = 2,
+  DOUBLE = 3,
+  TIME = 4,     //!< value in ns
+  STRING = 5,   //!< value in the text column
+  STAT = 6      //!< one field of a statistic
+};
+
+/**
+ * Collects the strings, attributes and rows of one run and lays them
+ * out as a chunk.
+ */
+class ChunkBuilder
+{
+public:
+  uint32_t Intern (const std::string &s)
+  {
+    std::map<std::string, uint32_t>::const_iterator it = m_ids.find (s);
+    if (it != m_ids.end ())
+      {
+        return it->second;
+      }
+    uint32_t id = m_strings.size ();
+    m_ids[s] = id;
+    m_strings.push_back (s);
+    return id;
+  }
+
+  void AddAttribute (const std::string &key, const std::string &value)
+  {
+    m_attrKeys.push_back (Intern (key));
+    m_attrValues.push_back (Intern (value));
+  }
+
+  void AddRow (uint8_t type, const std::string &context, const std::string &name,
+               const std::string &field, double value, uint32_t text = NONE)
+  {
+    m_value.push_back (value);
+    m_context.push_back (Intern (context));
+    m_name.push_back (Intern (name));
+    m_field.push_back (Intern (field));
+    m_text.push_back (text);
+    m_type.push_back (type);
+  }
+
+  /**
+   * Append the chunk to a buffer.
+   * \param out the buffer
+   */
+  void Serialize (std::vector<uint8_t> &out) const
+  {
+    size_t start = out.size ();
+    out.insert (out.end (), MAGIC, MAGIC + MAGIC_SIZE);
+    Put<uint64_t> (out, 0);   // patched below
+    Put<uint32_t> (out, m_strings.size ());
+    Put<uint32_t> (out, m_attrKeys.size ());
+    Put<uint32_t> (out, m_value.size ());
+    Put<uint32_t> (out, 0);
+
+    uint32_t offset = 0;
+    for (size_t i = 0; i < m_strings.size (); ++i)
+      {
+        Put<uint32_t> (out, offset);
+        offset += m_strings[i].size ();
+      }
+    Put<uint32_t> (out, offset);
+    Pad (out, start);
+    for (size_t i = 0; i < m_strings.size (); ++i)
+      {
+        out.insert (out.end (), m_strings[i].begin (), m_strings[i].end ());
+      }
+    Pad (out, start);
+    PutArray (out, m_attrKeys);
+    PutArray (out, m_attrValues);
+    Pad (out, start);
+    PutArray (out, m_value);
+    PutArray (out, m_context);
+    PutArray (out, m_name);
+    PutArray (out, m_field);
+    PutArray (out, m_text);
+    PutArray (out, m_type);
+    Pad (out, start);
+
+    uint64_t size = out.size () - start;
+    std::memcpy (&out[start + MAGIC_SIZE], &size, sizeof (size));
+  }
+
+private:
+  template <typename T>
+  static void Put (std::vector<uint8_t> &out, T v)
+  {
+    uint8_t bytes[sizeof (T)];
+    std::memcpy (bytes, &v, sizeof (T));
+    out.insert (out.end (), bytes, bytes + sizeof (T));
+  }
+
+  template <typename T>
+  static void PutArray (std::vector<uint8_t> &out, const std::vector<T> &v)
+  {
+    if (!v.empty ())
+      {
+        const uint8_t *p = reinterpret_cast<const uint8_t *> (&v[0]);
+        out.insert (out.end (), p, p + v.size () * sizeof (T));
+      }
+  }
+
+  static void Pad (std::vector<uint8_t> &out, size_t start)
+  {
+    while ((out.size () - start) % 8 != 0)
+      {
+        out.push_back (0);
+      }
+  }
+
+  std::map<std::string, uint32_t> m_ids;
+  std::vector<std::string> m_strings;
+  std::vector<uint32_t> m_attrKeys;
+  std::vector<uint32_t> m_attrValues;
+  std::vector<double> m_value;
+  std::vector<uint32_t> m_context;
+  std::vector<uint32_t> m_name;
+  std::vector<uint32_t> m_field;
+  std::vector<uint32_t> m_text;
+  std::vector<uint8_t> m_type;
+};
+
+/**
+ * Zero-copy view of one chunk.  The columns point into the caller's
+ * buffer, which must be 8 byte aligned (an mmap'ed file is).
+ */
+class Chunk
+{
+public:
+  Chunk ()
+    : m_size (0),
+      m_strings (0),
+      m_attributes (0),
+      m_rows (0)
+  {
+  }
+
+  /**
+   * \param p start of the chunk
+   * \param avail bytes available from p
+   * \return false if p does not hold a complete chunk
+   */
+  bool Parse (const uint8_t *p, size_t avail)
+  {
+    if (avail < HEADER_SIZE || std::memcmp (p, MAGIC, MAGIC_SIZE) != 0)
+      {
+        return false;
+      }
+    uint32_t counts[4];
+    std::memcpy (&m_size, p + MAGIC_SIZE, sizeof (m_size));
+    std::memcpy (counts, p + 16, sizeof (counts));
+    m_strings = counts[0];
+    m_attributes = counts[1];
+    m_rows = counts[2];
+    if (m_size > avail || m_size % 8 != 0)
+      {
+        return false;
+      }
+
+    size_t pos = HEADER_SIZE;
+    m_offsets = reinterpret_cast<const uint32_t *> (p + pos);
+    pos = Align (pos + (m_strings + 1) * 4);
+    if (pos > m_size)
+      {
+        return false;
+      }
+    m_bytes = reinterpret_cast<const char *> (p + pos);
+    pos = Align (pos + m_offsets[m_strings]);
+    m_attrKeys = reinterpret_cast<const uint32_t *> (p + pos);
+    m_attrValues = m_attrKeys + m_attributes;
+    pos = Align (pos + m_attributes * 8);
+    m_value = reinterpret_cast<const double *> (p + pos);
+    pos += m_rows * 8;
+    m_context = reinterpret_cast<const uint32_t *> (p + pos);
+    m_name = m_context + m_rows;
+    m_field = m_name + m_rows;
+    m_text = m_field + m_rows;
+    pos += m_rows * 16;
+    m_type = p + pos;
+    return Align (pos + m_rows) <= m_size;
+  }
+
+  uint64_t GetSize (void) const
+  {
+    return m_size;
+  }
+
+  uint32_t GetAttributes (void) const
+  {
+    return m_attributes;
+  }
+
+  uint32_t GetRows (void) const
+  {
+    return m_rows;
+  }
+
+  std::string String (uint32_t id) const
+  {
+    if (id >= m_strings)
+      {
+        return std::string ();
+      }
+    return std::string (m_bytes + m_offsets[id], m_offsets[id + 1] - m_offsets[id]);
+  }
+
+  std::string AttributeKey (uint32_t i) const
+  {
+    return String (m_attrKeys[i]);
+  }
+
+  std::string AttributeValue (uint32_t i) const
+  {
+    return String (m_attrValues[i]);
+  }
+
+  /**
+   * \param key attribute key
+   * \return the first value stored under key, or ""
+   */
+  std::string Attribute (const std::string &key) const
+  {
+    for (uint32_t i = 0; i < m_attributes; ++i)
+      {
+        if (AttributeKey (i) == key)
+          {
+            return AttributeValue (i);
+          }
+      }
+    return std::string ();
+  }
+
+  const double *Value (void) const
+  {
+    return m_value;
+  }
+  const uint32_t *Context (void) const
+  {
+    return m_context;
+  }
+  const uint32_t *Name (void) const
+  {
+    return m_name;
+  }
+  const uint32_t *Field (void) const
+  {
+    return m_field;
+  }
+  const uint32_t *Text (void) const
+  {
+    return m_text;
+  }
+  const uint8_t *Type (void) const
+  {
+    return m_type;
+  }
+
+private:
+  static size_t Align (size_t pos)
+  {
+    return (pos + 7) & ~static_cast<size_t> (7);
+  }
+
+  uint64_t m_size;
+  uint32_t m_strings;
+  uint32_t m_attributes;
+  uint32_t m_rows;
+  const uint32_t *m_offsets;
+  const char *m_bytes;
+  const uint32_t *m_attrKeys;
+  const uint32_t *m_attrValues;
+  const double *m_value;
+  const uint32_t *m_context;
+  const uint32_t *m_name;
+  const uint32_t *m_field;
+  const uint32_t *m_text;
+  const uint8_t *m_type;
+};
+
+} // namespace colstats
+} // namespace ns3
+
+#endif /* LY_COLUMNAR_STATS_FORMAT_H */
@@ -0,0 +1,135 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// DataCalculator around a DelaySketch (see delay-sketch.h).
+//
+// For key K it writes, through the DataOutputCallback and therefore in
+// every output format:
+//
+//   <context> K-p50 ... K-p99.9        quantiles (Time)
+//   <context> K-hist-<lower bound ns>  samples in that bucket, non-empty only
+//
+// The sample count is left to the TimeMinMaxAvgTotalCalculator the
+// sketch usually sits next to, so K must differ from its key.  Summing
+// the K-hist-* rows of several runs and reading quantiles off the sum
+// merges replications (ly2017210600StatsRead --sketch=K).
+//
+#ifndef LY_DELAY_SKETCH_CALCULATOR_H
+#define LY_DELAY_SKETCH_CALCULATOR_H
+
+#include <sstream>
+#include <string>
+
+#include "ns3/nstime.h"
+#include "ns3/stats-module.h"
+
+#include "delay-sketch.h"
+
+namespace ns3 {
+
+class DelaySketchCalculator : public DataCalculator
+{
+public:
+  static TypeId GetTypeId (void);
+
+  DelaySketchCalculator ();
+  virtual ~DelaySketchCalculator ();
+
+  void Update (const Time delay);
+  /**
+   * Add the samples of another calculator, e.g. of another replication.
+   * \param other the calculator to merge
+   */
+  void Merge (Ptr<const DelaySketchCalculator> other);
+
+  const DelaySketch &GetSketch (void) const;
+
+  virtual void Output (DataOutputCallback &callback) const;
+
+private:
+  DelaySketch m_sketch;
+};
+
+TypeId
+DelaySketchCalculator::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::DelaySketchCalculator")
+    .SetParent<DataCalculator> ()
+    .SetGroupName ("Stats")
+    .AddConstructor<DelaySketchCalculator> ()
+  ;
+  return tid;
+}
+
+DelaySketchCalculator::DelaySketchCalculator ()
+{
+}
+
+DelaySketchCalculator::~DelaySketchCalculator ()
+{
+}
+
+void
+DelaySketchCalculator::Update (const Time delay)
+{
+  if (m_enabled)
+    {
+      m_sketch.Record (delay.IsNegative () ? 0 : delay.GetNanoSeconds ());
+    }
+}
+
+void
+DelaySketchCalculator::Merge (Ptr<const DelaySketchCalculator> other)
+{
+  m_sketch.Merge (other->m_sketch);
+}
+
+const DelaySketch &
+DelaySketchCalculator::GetSketch (void) const
+{
+  return m_sketch;
+}
+
+void
+DelaySketchCalculator::Output (DataOutputCallback &callback) const
+{
+  static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+  static const char *names[] = { "-p50", "-p90", "-p99", "-p99.9" };
+
+  for (uint32_t q = 0; q < 4; ++q)
+    {
+      callback.OutputSingleton (m_context, m_key + names[q],
+                                NanoSeconds (m_sketch.Quantile (quantiles[q])));
+    }
+
+  const std::vector<uint64_t> &buckets = m_sketch.GetBuckets ();
+  for (uint32_t b = 0; b < buckets.size (); ++b)
+    {
+      if (buckets[b] != 0)
+        {
+          std::ostringstream name;
+          name << m_key << "-hist-" << DelaySketch::LowerBound (b);
+          callback.OutputSingleton (m_context, name.str (),
+                                    static_cast<uint32_t> (buckets[b]));
+        }
+    }
+}
+
+} // namespace ns3
+
+#endif /* LY_DELAY_SKETCH_CALCULATOR_H */
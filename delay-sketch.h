@@ -0,0 +1,208 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Constant-memory latency histogram in the style of HdrHistogram.
+//
+// Values are nanoseconds.  Below 32 ns every value has its own bucket;
+// above, each power of two is split into 32 linear sub-buckets, so a
+// bucket is at most 1/32 of its lower bound wide and a reported
+// quantile is within 1.6% of the true one.  Values up to 2^44 ns
+// (about 4.9 hours) are kept apart; larger ones share the last bucket.
+// The bucket layout is fixed, so two sketches merge by adding counts
+// and the bucket counts of many runs can be summed offline.  Nothing in
+// this header depends on ns-3, so the offline tools share it.
+//
+#ifndef LY_DELAY_SKETCH_H
+#define LY_DELAY_SKETCH_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace ns3 {
+
+class DelaySketch
+{
+public:
+  static const uint32_t SUB_BITS = 5;
+  static const uint64_t SUB = 1 << SUB_BITS;
+  static const uint32_t MAX_EXPONENT = 44;
+  static const uint32_t BUCKETS = SUB + (MAX_EXPONENT - SUB_BITS + 1) * SUB;
+
+  DelaySketch ()
+    : m_counts (BUCKETS, 0),
+      m_count (0),
+      m_min (0),
+      m_max (0)
+  {
+  }
+
+  void Record (uint64_t ns)
+  {
+    AddBucket (Bucket (ns), 1);
+    m_min = m_count == 1 ? ns : std::min (m_min, ns);
+    m_max = std::max (m_max, ns);
+  }
+
+  /**
+   * Add the samples of another sketch.
+   * \param other the sketch to merge
+   */
+  void Merge (const DelaySketch &other)
+  {
+    if (other.m_count == 0)
+      {
+        return;
+      }
+    uint64_t min = m_count == 0 ? other.m_min : std::min (m_min, other.m_min);
+    for (uint32_t b = 0; b < BUCKETS; ++b)
+      {
+        m_counts[b] += other.m_counts[b];
+      }
+    m_count += other.m_count;
+    m_min = min;
+    m_max = std::max (m_max, other.m_max);
+  }
+
+  /**
+   * Add samples by bucket, e.g. counts read back from an output file.
+   * The exact minimum and maximum are then those of the buckets.
+   * \param lower lower bound of the bucket (ns)
+   * \param count samples in it
+   */
+  void AddBucketCount (uint64_t lower, uint64_t count)
+  {
+    if (count == 0)
+      {
+        return;
+      }
+    uint32_t b = Bucket (lower);
+    uint64_t upper = LowerBound (b) + Width (b) - 1;
+    m_min = m_count == 0 ? LowerBound (b) : std::min (m_min, LowerBound (b));
+    m_max = std::max (m_max, upper);
+    AddBucket (b, count);
+  }
+
+  uint64_t GetCount (void) const
+  {
+    return m_count;
+  }
+
+  uint64_t GetMin (void) const
+  {
+    return m_min;
+  }
+
+  uint64_t GetMax (void) const
+  {
+    return m_max;
+  }
+
+  /**
+   * \param q quantile in [0, 1]
+   * \return the middle of the bucket holding the q-quantile, clamped to
+   *         the observed range; 0 if the sketch is empty
+   */
+  uint64_t Quantile (double q) const
+  {
+    if (m_count == 0)
+      {
+        return 0;
+      }
+    uint64_t rank = static_cast<uint64_t> (std::ceil (q * m_count));
+    rank = std::max<uint64_t> (1, std::min (rank, m_count));
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < BUCKETS; ++b)
+      {
+        seen += m_counts[b];
+        if (seen >= rank)
+          {
+            uint64_t mid = LowerBound (b) + Width (b) / 2;
+            return std::max (m_min, std::min (m_max, mid));
+          }
+      }
+    return m_max;
+  }
+
+  /// \return the counts, indexed by bucket
+  const std::vector<uint64_t> &GetBuckets (void) const
+  {
+    return m_counts;
+  }
+
+  static uint32_t Bucket (uint64_t ns)
+  {
+    if (ns < SUB)
+      {
+        return ns;
+      }
+    uint32_t exponent = 63 - Clz (ns);
+    if (exponent > MAX_EXPONENT)
+      {
+        return BUCKETS - 1;
+      }
+    uint32_t shift = exponent - SUB_BITS;
+    return SUB + shift * SUB + ((ns >> shift) - SUB);
+  }
+
+  static uint64_t LowerBound (uint32_t bucket)
+  {
+    if (bucket < SUB)
+      {
+        return bucket;
+      }
+    uint32_t shift = (bucket - SUB) / SUB;
+    return (SUB + (bucket - SUB) % SUB) << shift;
+  }
+
+  static uint64_t Width (uint32_t bucket)
+  {
+    return bucket < SUB ? 1 : static_cast<uint64_t> (1) << ((bucket - SUB) / SUB);
+  }
+
+private:
+  void AddBucket (uint32_t b, uint64_t count)
+  {
+    m_counts[b] += count;
+    m_count += count;
+  }
+
+  static uint32_t Clz (uint64_t v)
+  {
+#ifdef __GNUC__
+    return __builtin_clzll (v);
+#else
+    uint32_t n = 0;
+    for (uint64_t bit = static_cast<uint64_t> (1) << 63; !(v & bit); bit >>= 1)
+      {
+        ++n;
+      }
+    return n;
+#endif
+  }
+
+  std::vector<uint64_t> m_counts;
+  uint64_t m_count;
+  uint64_t m_min;
+  uint64_t m_max;
+};
+
+} // namespace ns3
+
+#endif /* LY_DELAY_SKETCH_H */
@@ -0,0 +1,329 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Periodic sampler of the remaining energy and consumption rate of
+// every node.
+//
+// One event per interval samples all nodes into a ring buffer of
+// preallocated rows, so the cost is one pass over the device models per
+// interval and nothing is allocated while the simulation runs.  The
+// ring is written out when it fills up and on Close().  Without a file
+// it keeps the most recent rows for GetRemaining()/GetPower().
+//
+// The time-series file (".lyts") is little-endian:
+//
+//   magic     "LYENER1\n"
+//   u32       nodes N, u32 reserved
+//   f64       sampling interval (s)
+//   u32 x N   node ids, padded to 8 bytes
+//   rows      f64 time (s), f32 remaining (J) x N, f32 power (W) x N
+//
+// Rows have a fixed size, so row k starts at a computable offset and
+// numpy.fromfile reads the file with a structured dtype.
+//
+// Radios accounted by a LazyRadioEnergy are sampled the same way; the
+// sample is then the only time their consumption is computed.
+//
+#ifndef LY_ENERGY_SAMPLER_H
+#define LY_ENERGY_SAMPLER_H
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+#include "ns3/nstime.h"
+#include "ns3/node.h"
+#include "ns3/energy-source.h"
+#include "ns3/energy-source-container.h"
+#include "ns3/device-energy-model.h"
+#include "ns3/device-energy-model-container.h"
+
+#include "lazy-radio-energy.h"
+
+namespace ns3 {
+
+class EnergySampler
+{
+public:
+  EnergySampler ();
+  ~EnergySampler ();
+
+  /**
+   * \param interval time between samples
+   * \param rows rows buffered in the ring before it is written out
+   */
+  void SetInterval (Time interval, uint32_t rows = 256);
+  /**
+   * Write samples taken from now on to a time-series file; without it
+   * only the ring is kept.  Must be called after Install().
+   * \param fileName the file to create
+   */
+  void Open (std::string fileName);
+  /**
+   * Sample the given device models from now on.  Model i must draw from
+   * source i, one radio per source as the helpers install them.  The
+   * remaining energy is the source's initial energy less the model's
+   * consumption.  Reading the consumption updates the source (ns-3.27
+   * and later), so every sample costs one source update per node.
+   * \param sources the energy source of every node
+   * \param models the radio energy model of every node
+   */
+  void Install (EnergySourceContainer sources, DeviceEnergyModelContainer models);
+  /**
+   * Sample the radios of a lazy energy account from now on.
+   * \param account the installed account
+   */
+  void Install (Ptr<LazyRadioEnergy> account);
+  void Close (void);
+
+  uint32_t GetNodes (void) const;
+  /// \return rows sampled so far
+  uint64_t GetSamples (void) const;
+  /**
+   * \param ago 0 for the most recent row still in the ring, 1 for the
+   *        one before, ...
+   * \param i index of the model given to Install()
+   */
+  double GetRemaining (uint32_t ago, uint32_t i) const;
+  double GetPower (uint32_t ago, uint32_t i) const;
+
+private:
+  void Reset (void);
+  double GetConsumption (uint32_t i) const;
+  void Sample (void);
+  void WriteRing (void);
+  uint32_t Row (uint32_t ago) const;
+
+  Time m_interval;
+  uint32_t m_rows;
+  std::vector<Ptr<DeviceEnergyModel> > m_models;
+  Ptr<LazyRadioEnergy> m_lazy;         //!< used instead of m_models if set
+  std::vector<uint32_t> m_nodeIds;
+  std::vector<double> m_initial;       //!< initial energy of each model's source
+  std::vector<double> m_lastConsumed;  //!< consumption at the previous sample
+
+  // ring of m_rows rows; row r is m_time[r] and the N values at r * N
+  std::vector<double> m_time;
+  std::vector<float> m_remaining;
+  std::vector<float> m_power;
+  uint32_t m_head;                     //!< next row to fill
+  uint32_t m_used;                     //!< rows in the ring
+  uint32_t m_pending;                  //!< newest rows not yet written
+  uint64_t m_samples;
+
+  std::FILE *m_file;
+  EventId m_event;
+};
+
+EnergySampler::EnergySampler ()
+  : m_interval (Seconds (1.0)),
+    m_rows (256),
+    m_head (0),
+    m_used (0),
+    m_pending (0),
+    m_samples (0),
+    m_file (0)
+{
+}
+
+EnergySampler::~EnergySampler ()
+{
+  Close ();
+}
+
+void
+EnergySampler::SetInterval (Time interval, uint32_t rows)
+{
+  NS_ABORT_MSG_IF (!interval.IsStrictlyPositive (), "Sampling interval must be positive");
+  NS_ABORT_MSG_IF (rows == 0, "The sample ring needs at least one row");
+  m_interval = interval;
+  m_rows = rows;
+}
+
+void
+EnergySampler::Install (EnergySourceContainer sources, DeviceEnergyModelContainer models)
+{
+  NS_ABORT_MSG_IF (sources.GetN () != models.GetN (),
+                   "One energy source per device energy model expected");
+  m_models.clear ();
+  m_nodeIds.clear ();
+  m_initial.clear ();
+  for (uint32_t i = 0; i < models.GetN (); ++i)
+    {
+      Ptr<EnergySource> source = sources.Get (i);
+      m_models.push_back (models.Get (i));
+      m_nodeIds.push_back (source->GetNode ()->GetId ());
+      m_initial.push_back (source->GetInitialEnergy ());
+    }
+  m_lazy = 0;
+  Reset ();
+}
+
+void
+EnergySampler::Install (Ptr<LazyRadioEnergy> account)
+{
+  m_models.clear ();
+  m_nodeIds.clear ();
+  m_initial.clear ();
+  for (uint32_t i = 0; i < account->GetN (); ++i)
+    {
+      m_nodeIds.push_back (account->GetPhy (i)->GetDevice ()->GetNode ()->GetId ());
+      m_initial.push_back (account->GetInitialEnergy ());
+    }
+  m_lazy = account;
+  Reset ();
+}
+
+void
+EnergySampler::Reset (void)
+{
+  uint32_t n = m_nodeIds.size ();
+  m_lastConsumed.assign (n, 0.0);
+  m_time.assign (m_rows, 0.0);
+  m_remaining.assign (static_cast<size_t> (m_rows) * n, 0.0f);
+  m_power.assign (static_cast<size_t> (m_rows) * n, 0.0f);
+  m_head = 0;
+  m_used = 0;
+  m_pending = 0;
+  m_samples = 0;
+  m_event.Cancel ();
+  m_event = Simulator::Schedule (m_interval, &EnergySampler::Sample, this);
+}
+
+void
+EnergySampler::Open (std::string fileName)
+{
+  NS_ABORT_MSG_IF (m_nodeIds.empty (), "EnergySampler::Open before Install");
+  if (m_file != 0)
+    {
+      std::fclose (m_file);
+    }
+  m_file = std::fopen (fileName.c_str (), "wb");
+  NS_ABORT_MSG_IF (m_file == 0, "Cannot open " << fileName << ": " << std::strerror (errno));
+
+  uint32_t header[2] = { static_cast<uint32_t> (m_nodeIds.size ()), 0 };
+  double interval = m_interval.GetSeconds ();
+  std::fwrite ("LYENER1\n", 1, 8, m_file);
+  std::fwrite (header, sizeof (header), 1, m_file);
+  std::fwrite (&interval, sizeof (interval), 1, m_file);
+  std::vector<uint32_t> ids (m_nodeIds);
+  if (ids.size () % 2 != 0)
+    {
+      ids.push_back (0);
+    }
+  std::fwrite (&ids[0], sizeof (uint32_t), ids.size (), m_file);
+  m_pending = 0;
+}
+
+void
+EnergySampler::Close (void)
+{
+  m_event.Cancel ();
+  if (m_file == 0)
+    {
+      return;
+    }
+  WriteRing ();
+  std::fclose (m_file);
+  m_file = 0;
+}
+
+uint32_t
+EnergySampler::GetNodes (void) const
+{
+  return m_nodeIds.size ();
+}
+
+uint64_t
+EnergySampler::GetSamples (void) const
+{
+  return m_samples;
+}
+
+uint32_t
+EnergySampler::Row (uint32_t ago) const
+{
+  NS_ABORT_MSG_IF (ago >= m_used, "Sample " << ago << " is no longer in the ring");
+  return (m_head + m_rows - 1 - ago) % m_rows;
+}
+
+double
+EnergySampler::GetRemaining (uint32_t ago, uint32_t i) const
+{
+  return m_remaining[static_cast<size_t> (Row (ago)) * m_nodeIds.size () + i];
+}
+
+double
+EnergySampler::GetPower (uint32_t ago, uint32_t i) const
+{
+  return m_power[static_cast<size_t> (Row (ago)) * m_nodeIds.size () + i];
+}
+
+double
+EnergySampler::GetConsumption (uint32_t i) const
+{
+  return m_lazy != 0 ? m_lazy->GetTotalEnergyConsumption (i) : m_models[i]->GetTotalEnergyConsumption ();
+}
+
+void
+EnergySampler::Sample (void)
+{
+  uint32_t n = m_nodeIds.size ();
+  size_t base = static_cast<size_t> (m_head) * n;
+  double seconds = m_interval.GetSeconds ();
+  m_time[m_head] = Simulator::Now ().GetSeconds ();
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      double consumed = GetConsumption (i);
+      m_remaining[base + i] = static_cast<float> (m_initial[i] - consumed);
+      m_power[base + i] = static_cast<float> ((consumed - m_lastConsumed[i]) / seconds);
+      m_lastConsumed[i] = consumed;
+    }
+  m_head = (m_head + 1) % m_rows;
+  m_used = m_used < m_rows ? m_used + 1 : m_rows;
+  m_pending = m_pending < m_rows ? m_pending + 1 : m_rows;
+  ++m_samples;
+  if (m_file != 0 && m_pending == m_rows)
+    {
+      WriteRing ();
+    }
+  m_event = Simulator::Schedule (m_interval, &EnergySampler::Sample, this);
+}
+
+void
+EnergySampler::WriteRing (void)
+{
+  uint32_t n = m_nodeIds.size ();
+  for (uint32_t k = 0; k < m_pending; ++k)
+    {
+      uint32_t r = (m_head + m_rows - m_pending + k) % m_rows;
+      std::fwrite (&m_time[r], sizeof (double), 1, m_file);
+      std::fwrite (&m_remaining[static_cast<size_t> (r) * n], sizeof (float), n, m_file);
+      std::fwrite (&m_power[static_cast<size_t> (r) * n], sizeof (float), n, m_file);
+    }
+  m_pending = 0;
+  std::fflush (m_file);
+}
+
+} // namespace ns3
+
+#endif /* LY_ENERGY_SAMPLER_H */
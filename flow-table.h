@@ -0,0 +1,483 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Flow matrix for the adhoc grid scenario.
+//
+// A flow table is a list of (src, dst, start, interval, size, count)
+// flows.  It is either read from a text file with one flow per line
+//
+//   # src dst start(s) interval(s) size(bytes) count [traffic]
+//   0   90  1   0.5  64  30
+//   1   91  3   0.5  64  30  onoff:0.2:1
+//
+// or generated.  A flow with a traffic generator (see traffic-sender.h),
+// given in its line or by SetTraffic(), is sent by a TrafficSender
+// instead of the fixed-interval Sender; count 0 then sends until the
+// end of the run.  All TrafficSenders of the table share one
+// TrafficDispatcher.  Install() creates one sender/Receiver pair per
+// flow and configures it through the application pointers; no Config
+// path is resolved and the Sender Tx trace is connected without context.
+// Every flow uses its own UDP port, so several flows may share a sink.
+//
+#ifndef LY_FLOW_TABLE_H
+#define LY_FLOW_TABLE_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/node-container.h"
+#include "ns3/ipv4-interface-container.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/udp-header.h"
+#include "ns3/udp-l4-protocol.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/string.h"
+#include "ns3/stats-module.h"
+#include "ns3/temp.h"
+
+#include "delay-sketch-calculator.h"
+#include "traffic-sender.h"
+#include "packet-pool.h"
+
+namespace ns3 {
+
+/**
+ * One application flow of the scenario.
+ */
+struct FlowSpec
+{
+  uint32_t src;      //!< sending node id
+  uint32_t dst;      //!< receiving node id
+  double start;      //!< sender start time (s)
+  double interval;   //!< time between packets (s)
+  uint32_t size;     //!< application packet size (bytes)
+  uint32_t count;    //!< packets to send
+  std::string traffic; //!< traffic generator, empty for Sender
+};
+
+/**
+ * Delay sketch of one flow.  Receiver::SetDelayTracker only takes a
+ * TimeMinMaxAvgTotalCalculator, whose Update() is not virtual, so the
+ * sketch is fed from the local delivery of the flow's UDP port at the
+ * receiving node, with the same timestamp tag Receiver reads.  Packet
+ * uids are not used; a PacketPool reuses them.
+ */
+struct FlowDelayProbe : public SimpleRefCount<FlowDelayProbe>
+{
+  uint16_t port;
+  Ptr<DelaySketchCalculator> sketch;
+};
+
+/**
+ * Reads or generates a flow matrix and installs its applications and
+ * statistics.
+ */
+class FlowTable
+{
+public:
+  FlowTable ();
+
+  void Add (const FlowSpec &flow);
+  /**
+   * Append the flows of a text file, one "src dst start interval size
+   * count" per line; '#' starts a comment.
+   * \param fileName the flow file
+   */
+  void Load (std::string fileName);
+  /**
+   * Append the historic pattern of the scenario: node i of the first
+   * grid row sends to node i of the last row, starting 1, 3, 5, 8, 11,
+   * ... seconds into the run.
+   * \param numNodes nodes in the grid
+   * \param gridWidth nodes per grid row
+   */
+  void GenerateRows (uint32_t numNodes, uint32_t gridWidth);
+  /**
+   * Append random distinct src/dst pairs drawn from the simulator's
+   * random stream.
+   * \param numFlows flows to add
+   * \param numNodes nodes in the grid
+   * \param maxStart flows start uniformly in [1, maxStart] seconds
+   */
+  void GenerateRandom (uint32_t numFlows, uint32_t numNodes, double maxStart);
+  /**
+   * Fill the table from a --flows specification: "" for the row pattern,
+   * "random:N" for N random flows or a file name.
+   */
+  void Configure (std::string spec, uint32_t numNodes, uint32_t gridWidth);
+  /**
+   * \param traffic generator of the flows that name none, empty to keep
+   *        Sender for them
+   */
+  void SetTraffic (std::string traffic);
+  /**
+   * \param pool recycle the packets of the flows sent by a TrafficSender;
+   *        Sender always allocates its own
+   */
+  void SetPacketPool (Ptr<PacketPool> pool);
+
+  /**
+   * Create and configure the Sender and Receiver of every flow.
+   * \param nodes the scenario nodes, indexed by node id
+   * \param interfaces the interfaces holding each node's address
+   */
+  void Install (NodeContainer nodes, Ipv4InterfaceContainer interfaces);
+  /**
+   * Create the per-flow application statistics and register them in the
+   * order the omnet output has always used.
+   * \param data the collector of this run
+   */
+  void InstallStatistics (DataCollector &data);
+
+  uint32_t GetN (void) const;
+  const FlowSpec &Get (uint32_t i) const;
+  /// \return the Sender or TrafficSender of flow i
+  Ptr<Application> GetSender (uint32_t i) const;
+  Ptr<Receiver> GetReceiver (uint32_t i) const;
+
+  /// first UDP port; flow i uses BASE_PORT + i
+  static const uint16_t BASE_PORT = 1603;
+
+private:
+  static std::string NodeContext (uint32_t node);
+  /// Sender Tx sinks; unlike PacketUpdate they take no context string
+  static void CountPacket (Ptr<PacketCounterCalculator> calc, Ptr<const Packet> packet);
+  static void CountPacketSize (Ptr<PacketSizeMinMaxAvgTotalCalculator> calc,
+                               Ptr<const Packet> packet);
+  static void ProbeDeliver (Ptr<FlowDelayProbe> probe, const Ipv4Header &header,
+                            Ptr<const Packet> packet, uint32_t interface);
+
+  std::vector<FlowSpec> m_flows;
+  std::string m_traffic;
+  Ptr<PacketPool> m_pool;
+  Ptr<TrafficDispatcher> m_dispatcher;   //!< one event for all TrafficSenders
+  std::vector<Ptr<Application> > m_senders;
+  std::vector<Ptr<Receiver> > m_receivers;
+};
+
+FlowTable::FlowTable ()
+{
+}
+
+void
+FlowTable::Add (const FlowSpec &flow)
+{
+  m_flows.push_back (flow);
+}
+
+void
+FlowTable::Load (std::string fileName)
+{
+  std::ifstream in (fileName.c_str ());
+  NS_ABORT_MSG_IF (!in, "Cannot open flow file " << fileName);
+  std::string line;
+  uint32_t lineNo = 0;
+  while (std::getline (in, line))
+    {
+      ++lineNo;
+      std::string::size_type hash = line.find ('#');
+      if (hash != std::string::npos)
+        {
+          line.erase (hash);
+        }
+      std::istringstream fields (line);
+      FlowSpec flow;
+      if (!(fields >> flow.src))
+        {
+          continue;
+        }
+      NS_ABORT_MSG_IF (!(fields >> flow.dst >> flow.start >> flow.interval >> flow.size >> flow.count),
+                       fileName << ":" << lineNo << ": expected src dst start interval size count");
+      fields >> flow.traffic;
+      Add (flow);
+    }
+}
+
+void
+FlowTable::GenerateRows (uint32_t numNodes, uint32_t gridWidth)
+{
+  static const double starts[] = { 1, 3, 5, 8, 11, 14, 17, 20, 23, 26 };
+  uint32_t n = std::min (gridWidth, numNodes / 2);
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      FlowSpec flow;
+      flow.src = i;
+      flow.dst = numNodes - n + i;
+      flow.start = i < 10 ? starts[i] : starts[9] + 3 * (i - 9);
+      flow.interval = 0.5;
+      flow.size = 64;
+      flow.count = 30;
+      Add (flow);
+    }
+}
+
+void
+FlowTable::GenerateRandom (uint32_t numFlows, uint32_t numNodes, double maxStart)
+{
+  NS_ABORT_MSG_IF (numNodes < 2, "Random flows need at least two nodes");
+  Ptr<UniformRandomVariable> rng = CreateObject<UniformRandomVariable> ();
+  for (uint32_t i = 0; i < numFlows; ++i)
+    {
+      FlowSpec flow;
+      flow.src = rng->GetInteger (0, numNodes - 1);
+      do
+        {
+          flow.dst = rng->GetInteger (0, numNodes - 1);
+        }
+      while (flow.dst == flow.src);
+      flow.start = rng->GetValue (1.0, maxStart);
+      flow.interval = 0.5;
+      flow.size = 64;
+      flow.count = 30;
+      Add (flow);
+    }
+}
+
+void
+FlowTable::Configure (std::string spec, uint32_t numNodes, uint32_t gridWidth)
+{
+  if (spec.empty ())
+    {
+      GenerateRows (numNodes, gridWidth);
+    }
+  else if (spec.compare (0, 7, "random:") == 0)
+    {
+      GenerateRandom (std::atoi (spec.c_str () + 7), numNodes, 26.0);
+    }
+  else
+    {
+      Load (spec);
+    }
+  for (uint32_t i = 0; i < m_flows.size (); ++i)
+    {
+      NS_ABORT_MSG_IF (m_flows[i].src >= numNodes || m_flows[i].dst >= numNodes,
+                       "Flow " << i << " uses a node outside 0.." << numNodes - 1);
+    }
+}
+
+void
+FlowTable::SetTraffic (std::string traffic)
+{
+  m_traffic = traffic;
+}
+
+void
+FlowTable::SetPacketPool (Ptr<PacketPool> pool)
+{
+  m_pool = pool;
+}
+
+void
+FlowTable::Install (NodeContainer nodes, Ipv4InterfaceContainer interfaces)
+{
+  m_senders.clear ();
+  m_receivers.clear ();
+  m_dispatcher = 0;
+  for (uint32_t i = 0; i < m_flows.size (); ++i)
+    {
+      const FlowSpec &flow = m_flows[i];
+      std::string traffic = flow.traffic.empty () ? m_traffic : flow.traffic;
+      Ptr<Application> sender;
+      if (traffic.empty ())
+        {
+          std::ostringstream interval;
+          interval << "ns3::ConstantRandomVariable[Constant=" << flow.interval << "]";
+          sender = CreateObject<Sender> ();//发送器sender
+          sender->SetAttribute ("PacketSize", UintegerValue (flow.size));
+          sender->SetAttribute ("Interval", StringValue (interval.str ()));
+        }
+      else
+        {
+          Ptr<TrafficSender> trafficSender = CreateObject<TrafficSender> ();
+          trafficSender->SetGenerator (CreateTrafficGenerator (traffic, Seconds (flow.interval),
+                                                               flow.size));
+          trafficSender->SetPacketPool (m_pool);
+          if (m_dispatcher == 0)
+            {
+              m_dispatcher = Create<TrafficDispatcher> ();
+            }
+          trafficSender->SetDispatcher (m_dispatcher);
+          sender = trafficSender;
+        }
+      sender->SetAttribute ("Destination", Ipv4AddressValue (interfaces.GetAddress (flow.dst)));
+      sender->SetAttribute ("Port", UintegerValue (BASE_PORT + i));
+      sender->SetAttribute ("NumPackets", UintegerValue (flow.count));
+      nodes.Get (flow.src)->AddApplication (sender);
+      sender->SetStartTime (Seconds (flow.start));
+
+      Ptr<Receiver> receiver = CreateObject<Receiver> ();//接收器receiver
+      receiver->SetAttribute ("Port", UintegerValue (BASE_PORT + i));
+      nodes.Get (flow.dst)->AddApplication (receiver);
+      receiver->SetStartTime (Seconds (0));
+
+      m_senders.push_back (sender);
+      m_receivers.push_back (receiver);
+    }
+}
+
+void
+FlowTable::InstallStatistics (DataCollector &data)
+{
+  // This counter tracks how many packets---as opposed to frames---are
+  // generated.  This is connected directly to a trace signal provided
+  // by our Sender class.
+  for (uint32_t i = 0; i < m_flows.size (); ++i)
+    {
+      Ptr<PacketCounterCalculator> appTx =
+        CreateObject<PacketCounterCalculator>();
+      appTx->SetKey ("sender-tx-packets");
+      appTx->SetContext (NodeContext (m_flows[i].src));
+      m_senders[i]->TraceConnectWithoutContext
+        ("Tx", MakeBoundCallback (&FlowTable::CountPacket, appTx));
+      data.AddDataCalculator (appTx);
+    }
+
+  // Here a counter for received packets is directly manipulated by
+  // the Receiver Application, which calls its Update() method whenever
+  // a packet arrives.
+  for (uint32_t i = 0; i < m_flows.size (); ++i)
+    {
+      Ptr<CounterCalculator<> > appRx =
+        CreateObject<CounterCalculator<> >();
+      appRx->SetKey ("receiver-rx-packets");
+      appRx->SetContext (NodeContext (m_flows[i].dst));
+      m_receivers[i]->SetCounter (appRx);//Receiver::SetCounter
+      data.AddDataCalculator (appRx);
+    }
+
+  // Packet size statistics (min, max, avg, total # bytes) of what each
+  // Sender transmits.
+  for (uint32_t i = 0; i < m_flows.size (); ++i)
+    {
+      Ptr<PacketSizeMinMaxAvgTotalCalculator> appTxPkts =
+        CreateObject<PacketSizeMinMaxAvgTotalCalculator>();
+      appTxPkts->SetKey ("tx-pkt-size");
+      appTxPkts->SetContext (NodeContext (m_flows[i].src));
+      m_senders[i]->TraceConnectWithoutContext
+        ("Tx", MakeBoundCallback (&FlowTable::CountPacketSize, appTxPkts));
+      data.AddDataCalculator (appTxPkts);
+    }
+
+  // Min, max, total, and average end-to-end delay of every flow, from
+  // the timestamp tag the Sender puts on each packet.
+  for (uint32_t i = 0; i < m_flows.size (); ++i)
+    {
+      std::ostringstream key;
+      key << "delay" << i;
+      Ptr<TimeMinMaxAvgTotalCalculator> delayStat =
+        CreateObject<TimeMinMaxAvgTotalCalculator>();
+      delayStat->SetKey (key.str ());
+      delayStat->SetContext (".");
+      m_receivers[i]->SetDelayTracker (delayStat);//Receiver::SetDelayTracker
+      data.AddDataCalculator (delayStat);
+    }
+
+  // Delay distribution of every flow: quantiles and histogram buckets
+  // under "delay<i>-sketch", next to the "delay<i>" summary.
+  for (uint32_t i = 0; i < m_flows.size (); ++i)
+    {
+      std::ostringstream key;
+      key << "delay" << i << "-sketch";
+      Ptr<FlowDelayProbe> probe = Create<FlowDelayProbe> ();
+      probe->port = BASE_PORT + i;
+      probe->sketch = CreateObject<DelaySketchCalculator> ();
+      probe->sketch->SetKey (key.str ());
+      probe->sketch->SetContext (".");
+      Ptr<Ipv4L3Protocol> ipv4 = m_receivers[i]->GetNode ()->GetObject<Ipv4L3Protocol> ();
+      NS_ABORT_MSG_IF (ipv4 == 0, "Flow " << i << " sink has no IPv4 stack");
+      ipv4->TraceConnectWithoutContext
+        ("LocalDeliver", MakeBoundCallback (&FlowTable::ProbeDeliver, probe));
+      data.AddDataCalculator (probe->sketch);
+    }
+}
+
+uint32_t
+FlowTable::GetN (void) const
+{
+  return m_flows.size ();
+}
+
+const FlowSpec &
+FlowTable::Get (uint32_t i) const
+{
+  return m_flows[i];
+}
+
+Ptr<Application>
+FlowTable::GetSender (uint32_t i) const
+{
+  return m_senders[i];
+}
+
+Ptr<Receiver>
+FlowTable::GetReceiver (uint32_t i) const
+{
+  return m_receivers[i];
+}
+
+std::string
+FlowTable::NodeContext (uint32_t node)
+{
+  std::ostringstream context;
+  context << "node[" << node << "]";
+  return context.str ();
+}
+
+void
+FlowTable::CountPacket (Ptr<PacketCounterCalculator> calc, Ptr<const Packet> packet)
+{
+  calc->Update ();
+}
+
+void
+FlowTable::CountPacketSize (Ptr<PacketSizeMinMaxAvgTotalCalculator> calc,
+                            Ptr<const Packet> packet)
+{
+  calc->Update (packet->GetSize ());
+}
+
+void
+FlowTable::ProbeDeliver (Ptr<FlowDelayProbe> probe, const Ipv4Header &header,
+                         Ptr<const Packet> packet, uint32_t interface)
+{
+  // every packet delivered at the sink node passes here, still with
+  // its UDP header
+  if (header.GetProtocol () != UdpL4Protocol::PROT_NUMBER)
+    {
+      return;
+    }
+  UdpHeader udp;
+  packet->PeekHeader (udp);
+  TimestampTag timestamp;
+  if (udp.GetDestinationPort () == probe->port && packet->FindFirstMatchingByteTag (timestamp))
+    {
+      probe->sketch->Update (Simulator::Now () - timestamp.GetTimestamp ());
+    }
+}
+
+} // namespace ns3
+
+#endif /* LY_FLOW_TABLE_H */
@@ -0,0 +1,701 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// YansWifiChannel that only evaluates receivers near the sender.
+//
+// YansWifiChannel::Send computes loss and delay to every other PHY and
+// schedules a reception for each, although a reception below the
+// receiver's energy detection threshold is dropped on arrival.  This
+// channel buckets the PHYs into a uniform grid whose cell is the
+// largest distance at which any PHY can still detect any other: the
+// Friis range for the highest TxPowerEnd + TxGain, highest RxGain and
+// lowest EnergyDetectionThreshold.  A transmission only visits the 3x3
+// cells around the sender; those PHYs get exactly the loss, delay and
+// arrival order of YansWifiChannel, and the others could not have
+// detected the frame.
+//
+// YansWifiChannel::Send is not virtual, so GridYansWifiPhy overrides
+// StartTx to call the grid channel instead, and GridYansWifiPhyHelper
+// creates such PHYs from an already configured YansWifiPhyHelper:
+//
+//   Ptr<GridYansWifiChannel> channel = CreateObject<GridYansWifiChannel> ();
+//   channel->SetPropagationLossModel (CreateObject<FriisPropagationLossModel> ());
+//   channel->SetPropagationDelayModel (CreateObject<ConstantSpeedPropagationDelayModel> ());
+//   GridYansWifiPhyHelper gridPhy (wifiPhy, channel);
+//   NetDeviceContainer devices = wifi.Install (gridPhy, wifiMac, c);
+//
+// The range is derived automatically for a single FriisPropagationLossModel,
+// possibly wrapped in a CachedPropagationLossModel; other loss models
+// need SetMaxRange().  Without a range every PHY is visited as in
+// YansWifiChannel.
+//
+// Moving nodes are handled kinetically.  Given a bound on their speed
+// (SetMaxSpeed), the PHYs are bucketed by their position at time t0 in
+// cells of range * (1 + slack).  Until t0 + slack * range / (2 vmax)
+// two PHYs in range of each other are still at most one cell apart in
+// bucketed positions, so the 3x3 cells remain a superset; the grid is
+// rebuilt when that time has passed.  A CourseChange only rebuilds if
+// the node jumped (moved faster than the bound allows); a velocity
+// above the bound disables culling.  Without a speed bound, nodes that
+// are not on a ConstantPositionMobilityModel disable culling.
+//
+// With SetSkipAsleep(true) no reception is scheduled for radios in
+// sleep mode, which would drop the frame on arrival anyway.  Unlike
+// YansWifiChannel, such a radio then fires no PhyRxDrop trace, and the
+// frame is missing from its interference history, so a frame it starts
+// receiving right after waking sees slightly less interference.
+//
+#ifndef LY_GRID_YANS_WIFI_CHANNEL_H
+#define LY_GRID_YANS_WIFI_CHANNEL_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "ns3/abort.h"
+#include "ns3/callback.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/vector.h"
+#include "ns3/simulator.h"
+#include "ns3/mobility-model.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/propagation-delay-model.h"
+#include "ns3/net-device.h"
+#include "ns3/node.h"
+#include "ns3/yans-wifi-channel.h"
+#include "ns3/yans-wifi-phy.h"
+#include "ns3/yans-wifi-helper.h"
+#include "ns3/wifi-utils.h"
+#include "ns3/error-rate-model.h"
+#include "ns3/frame-capture-model.h"
+#include "ns3/preamble-detection-model.h"
+#include "cached-propagation-models.h"
+
+namespace ns3 {
+
+class GridYansWifiPhy;
+
+class GridYansWifiChannel : public YansWifiChannel
+{
+public:
+  static TypeId GetTypeId (void);
+
+  GridYansWifiChannel ();
+  virtual ~GridYansWifiChannel ();
+
+  // These hide the YansWifiChannel versions and forward to them, so
+  // the base channel stays usable (GetNDevices, GetDevice).
+  void SetPropagationLossModel (const Ptr<PropagationLossModel> loss);
+  void SetPropagationDelayModel (const Ptr<PropagationDelayModel> delay);
+
+  /**
+   * Register a PHY for culled delivery.  Called by
+   * GridYansWifiPhyHelper after the PHY joined the base channel.
+   * \param phy the PHY
+   */
+  void AddGridPhy (Ptr<GridYansWifiPhy> phy);
+  /**
+   * Fix the culling range instead of deriving it from a Friis model.
+   * \param range metres beyond which no PHY can detect another; 0
+   *        disables culling
+   */
+  void SetMaxRange (double range);
+  /// \return the culling range in use, 0 if every PHY is visited
+  double GetMaxRange (void);
+  /**
+   * Distance at which a Friis model brings a frame down to the energy
+   * detection threshold, rounded up so a receiver right at the
+   * threshold is always inside.
+   * \param friis the loss model
+   * \param txDbm transmit power including the TxGain
+   * \param rxGainDb receiver gain
+   * \param edDbm EnergyDetectionThreshold
+   * \return metres
+   */
+  static double FriisRange (Ptr<FriisPropagationLossModel> friis,
+                            double txDbm, double rxGainDb, double edDbm);
+  /**
+   * Allow culling among moving nodes.
+   * \param speed m/s no node ever exceeds
+   * \param slack extra cell size as a fraction of the range; a larger
+   *        slack rebuilds less often but visits more PHYs
+   */
+  void SetMaxSpeed (double speed, double slack = 0.25);
+  /// \return number of times the PHYs were bucketed
+  uint64_t GetRebuilds (void) const;
+
+  /**
+   * Deliver a frame to the PHYs that can detect it.
+   * \param sender the transmitting PHY
+   * \param packet the frame
+   * \param txPowerDbm transmit power including the TxGain
+   * \param duration frame duration
+   */
+  void Send (Ptr<GridYansWifiPhy> sender, Ptr<const Packet> packet,
+             double txPowerDbm, Time duration);
+
+  /// \param skip schedule no receptions at radios in sleep mode
+  void SetSkipAsleep (bool skip);
+
+  /// \return receivers evaluated and receivers skipped by the grid
+  uint64_t GetEvaluated (void) const;
+  uint64_t GetSkipped (void) const;
+  /// \return receivers skipped because their radio was asleep
+  uint64_t GetAsleep (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  static LogComponent g_log;           //!< for the NS_LOG macros
+
+  void Rebuild (void);
+  static void CourseChanged (GridYansWifiChannel *channel, uint32_t index,
+                             Ptr<const MobilityModel> mobility);
+  double FriisRange (void) const;
+  void Deliver (Ptr<GridYansWifiPhy> sender, Ptr<MobilityModel> senderMobility,
+                uint32_t index, Ptr<const Packet> packet, double txPowerDbm, Time duration);
+  static void Receive (Ptr<YansWifiPhy> phy, Ptr<Packet> packet, double rxPowerDbm, Time duration);
+
+  std::vector<Ptr<GridYansWifiPhy> > m_phys;
+  Ptr<PropagationLossModel> m_loss;
+  Ptr<PropagationDelayModel> m_delay;
+
+  bool m_built;
+  bool m_tracking;             //!< CourseChange sinks connected
+  double m_range;              //!< fixed range, < 0 to derive it
+  double m_maxSpeed;           //!< speed bound, < 0 if none
+  double m_slack;
+  bool m_static;               //!< every PHY on a ConstantPositionMobilityModel
+  double m_cell;               //!< cell size in use, 0 = no culling
+  Time m_builtAt;
+  Time m_validUntil;           //!< the buckets are a superset until then
+  std::vector<Vector> m_anchor;        //!< positions at m_builtAt
+  double m_minX;
+  double m_minY;
+  uint32_t m_nx;
+  uint32_t m_ny;
+  std::vector<uint32_t> m_cellOf;      //!< cell of every PHY
+  std::vector<uint32_t> m_cellStart;   //!< CSR offsets into m_cellPhys
+  std::vector<uint32_t> m_cellPhys;    //!< PHY indices, ascending per cell
+  std::vector<uint32_t> m_candidates;  //!< scratch for Send
+  bool m_skipAsleep;
+
+  uint64_t m_evaluated;
+  uint64_t m_skipped;
+  uint64_t m_asleep;
+  uint64_t m_rebuilds;
+};
+
+/**
+ * YansWifiPhy that transmits through a GridYansWifiChannel.
+ */
+class GridYansWifiPhy : public YansWifiPhy
+{
+public:
+  static TypeId GetTypeId (void);
+
+  GridYansWifiPhy ();
+  virtual ~GridYansWifiPhy ();
+
+  void SetGridChannel (Ptr<GridYansWifiChannel> channel, uint32_t index);
+  uint32_t GetGridIndex (void) const;
+
+  virtual void StartTx (Ptr<Packet> packet, WifiTxVector txVector, Time txDuration);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  Ptr<GridYansWifiChannel> m_gridChannel;
+  uint32_t m_gridIndex;
+};
+
+/**
+ * Creates GridYansWifiPhys configured like a given YansWifiPhyHelper.
+ */
+class GridYansWifiPhyHelper : public YansWifiPhyHelper
+{
+public:
+  /**
+   * \param phy helper holding the PHY attributes, error rate model and
+   *        pcap settings to use
+   * \param channel the channel every PHY joins
+   */
+  GridYansWifiPhyHelper (const YansWifiPhyHelper &phy, Ptr<GridYansWifiChannel> channel);
+
+  virtual Ptr<WifiPhy> Create (Ptr<Node> node, Ptr<NetDevice> device) const;
+
+private:
+  Ptr<GridYansWifiChannel> m_gridChannel;
+};
+
+LogComponent GridYansWifiChannel::g_log ("GridYansWifiChannel", __FILE__);
+
+TypeId
+GridYansWifiChannel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::GridYansWifiChannel")
+    .SetParent<YansWifiChannel> ()
+    .SetGroupName ("Wifi")
+    .AddConstructor<GridYansWifiChannel> ()
+  ;
+  return tid;
+}
+
+GridYansWifiChannel::GridYansWifiChannel ()
+  : m_built (false),
+    m_tracking (false),
+    m_range (-1),
+    m_maxSpeed (-1),
+    m_slack (0.25),
+    m_static (true),
+    m_cell (0),
+    m_minX (0),
+    m_minY (0),
+    m_nx (0),
+    m_ny (0),
+    m_skipAsleep (false),
+    m_evaluated (0),
+    m_skipped (0),
+    m_asleep (0),
+    m_rebuilds (0)
+{
+}
+
+GridYansWifiChannel::~GridYansWifiChannel ()
+{
+}
+
+void
+GridYansWifiChannel::DoDispose (void)
+{
+  m_phys.clear ();
+  m_loss = 0;
+  m_delay = 0;
+  YansWifiChannel::DoDispose ();
+}
+
+void
+GridYansWifiChannel::SetPropagationLossModel (const Ptr<PropagationLossModel> loss)
+{
+  YansWifiChannel::SetPropagationLossModel (loss);
+  m_loss = loss;
+  m_built = false;
+}
+
+void
+GridYansWifiChannel::SetPropagationDelayModel (const Ptr<PropagationDelayModel> delay)
+{
+  YansWifiChannel::SetPropagationDelayModel (delay);
+  m_delay = delay;
+}
+
+void
+GridYansWifiChannel::AddGridPhy (Ptr<GridYansWifiPhy> phy)
+{
+  phy->SetGridChannel (this, m_phys.size ());
+  m_phys.push_back (phy);
+  m_built = false;
+}
+
+void
+GridYansWifiChannel::SetMaxRange (double range)
+{
+  m_range = range;
+  m_built = false;
+}
+
+void
+GridYansWifiChannel::SetMaxSpeed (double speed, double slack)
+{
+  NS_ABORT_MSG_IF (speed <= 0 || slack <= 0, "Speed bound and slack must be positive");
+  m_maxSpeed = speed;
+  m_slack = slack;
+  m_built = false;
+}
+
+uint64_t
+GridYansWifiChannel::GetRebuilds (void) const
+{
+  return m_rebuilds;
+}
+
+double
+GridYansWifiChannel::GetMaxRange (void)
+{
+  if (!m_built)
+    {
+      Rebuild ();
+    }
+  return m_cell;
+}
+
+uint64_t
+GridYansWifiChannel::GetEvaluated (void) const
+{
+  return m_evaluated;
+}
+
+uint64_t
+GridYansWifiChannel::GetSkipped (void) const
+{
+  return m_skipped;
+}
+
+void
+GridYansWifiChannel::SetSkipAsleep (bool skip)
+{
+  m_skipAsleep = skip;
+}
+
+uint64_t
+GridYansWifiChannel::GetAsleep (void) const
+{
+  return m_asleep;
+}
+
+double
+GridYansWifiChannel::FriisRange (void) const
+{
+  Ptr<PropagationLossModel> loss = m_loss;
+  Ptr<CachedPropagationLossModel> cached = DynamicCast<CachedPropagationLossModel> (loss);
+  if (cached != 0 && cached->GetNext () == 0)
+    {
+      loss = cached->GetInner ();
+    }
+  Ptr<FriisPropagationLossModel> friis = DynamicCast<FriisPropagationLossModel> (loss);
+  if (friis == 0 || friis->GetNext () != 0 || m_phys.empty ())
+    {
+      return 0;
+    }
+  double txMax = -std::numeric_limits<double>::max ();
+  double rxGainMax = -std::numeric_limits<double>::max ();
+  double edMin = std::numeric_limits<double>::max ();
+  for (uint32_t i = 0; i < m_phys.size (); ++i)
+    {
+      txMax = std::max (txMax, m_phys[i]->GetTxPowerEnd () + m_phys[i]->GetTxGain ());
+      rxGainMax = std::max (rxGainMax, m_phys[i]->GetRxGain ());
+      edMin = std::min (edMin, m_phys[i]->GetEdThreshold ());
+    }
+  return FriisRange (friis, txMax, rxGainMax, edMin);
+}
+
+double
+GridYansWifiChannel::FriisRange (Ptr<FriisPropagationLossModel> friis,
+                                 double txDbm, double rxGainDb, double edDbm)
+{
+  DoubleValue frequency;
+  DoubleValue systemLoss;
+  friis->GetAttribute ("Frequency", frequency);
+  friis->GetAttribute ("SystemLoss", systemLoss);
+  // rx = tx + 10 log10 (lambda^2 / (16 pi^2 d^2 L)), solved for rx + gain = ed
+  double lambda = 299792458.0 / frequency.Get ();
+  double budgetDb = txDbm + rxGainDb - edDbm;
+  double range = lambda / (4 * M_PI) * std::sqrt (std::pow (10.0, budgetDb / 10) / systemLoss.Get ());
+  // rounding must never cull a receiver right at the threshold
+  return range * (1 + 1e-6) + 1e-3;
+}
+
+void
+GridYansWifiChannel::CourseChanged (GridYansWifiChannel *channel, uint32_t index,
+                                    Ptr<const MobilityModel> mobility)
+{
+  if (!channel->m_built || channel->m_cell == 0)
+    {
+      return;
+    }
+  if (channel->m_static)
+    {
+      // a static node was moved by hand; bucket again before the next frame
+      channel->m_built = false;
+      return;
+    }
+  Vector v = mobility->GetVelocity ();
+  if (std::sqrt (v.x * v.x + v.y * v.y) > channel->m_maxSpeed * (1 + 1e-9))
+    {
+      NS_LOG_WARN ("node moves faster than " << channel->m_maxSpeed
+                   << " m/s, culling disabled");
+      channel->m_maxSpeed = -1;
+      channel->m_built = false;
+      return;
+    }
+  double allowed = channel->m_maxSpeed * (Simulator::Now () - channel->m_builtAt).GetSeconds ();
+  Vector p = mobility->GetPosition ();
+  Vector a = channel->m_anchor[index];
+  double dx = p.x - a.x;
+  double dy = p.y - a.y;
+  if (std::sqrt (dx * dx + dy * dy) > allowed * (1 + 1e-9) + 1e-6)
+    {
+      channel->m_built = false;
+    }
+}
+
+void
+GridYansWifiChannel::Rebuild (void)
+{
+  m_built = true;
+  ++m_rebuilds;
+  double range = m_range >= 0 ? m_range : FriisRange ();
+  m_static = true;
+  for (uint32_t i = 0; i < m_phys.size (); ++i)
+    {
+      if (DynamicCast<ConstantPositionMobilityModel> (m_phys[i]->GetMobility ()) == 0)
+        {
+          m_static = false;
+        }
+    }
+  m_builtAt = Simulator::Now ();
+  if (range <= 0 || (!m_static && m_maxSpeed <= 0))
+    {
+      m_cell = 0;
+      m_validUntil = Time::Max ();
+      return;
+    }
+  if (m_static)
+    {
+      m_cell = range;
+      m_validUntil = Time::Max ();
+    }
+  else
+    {
+      m_cell = range * (1 + m_slack);
+      m_validUntil = m_builtAt + Seconds (m_slack * range / (2 * m_maxSpeed));
+    }
+  if (!m_tracking)
+    {
+      m_tracking = true;
+      for (uint32_t i = 0; i < m_phys.size (); ++i)
+        {
+          m_phys[i]->GetMobility ()->TraceConnectWithoutContext
+            ("CourseChange", MakeBoundCallback (&GridYansWifiChannel::CourseChanged, this, i));
+        }
+    }
+
+  double maxX = -std::numeric_limits<double>::max ();
+  double maxY = -std::numeric_limits<double>::max ();
+  m_minX = std::numeric_limits<double>::max ();
+  m_minY = std::numeric_limits<double>::max ();
+  m_anchor.resize (m_phys.size ());
+  for (uint32_t i = 0; i < m_phys.size (); ++i)
+    {
+      Vector p = m_phys[i]->GetMobility ()->GetPosition ();
+      m_anchor[i] = p;
+      m_minX = std::min (m_minX, p.x);
+      m_minY = std::min (m_minY, p.y);
+      maxX = std::max (maxX, p.x);
+      maxY = std::max (maxY, p.y);
+    }
+  m_nx = static_cast<uint32_t> ((maxX - m_minX) / m_cell) + 1;
+  m_ny = static_cast<uint32_t> ((maxY - m_minY) / m_cell) + 1;
+
+  // counting sort of the PHYs by cell keeps each cell in PHY order
+  m_cellOf.resize (m_phys.size ());
+  m_cellStart.assign (static_cast<size_t> (m_nx) * m_ny + 1, 0);
+  for (uint32_t i = 0; i < m_phys.size (); ++i)
+    {
+      const Vector &p = m_anchor[i];
+      uint32_t cx = static_cast<uint32_t> ((p.x - m_minX) / m_cell);
+      uint32_t cy = static_cast<uint32_t> ((p.y - m_minY) / m_cell);
+      m_cellOf[i] = cy * m_nx + cx;
+      ++m_cellStart[m_cellOf[i] + 1];
+    }
+  for (uint32_t c = 0; c + 1 < m_cellStart.size (); ++c)
+    {
+      m_cellStart[c + 1] += m_cellStart[c];
+    }
+  m_cellPhys.resize (m_phys.size ());
+  std::vector<uint32_t> fill (m_cellStart.begin (), m_cellStart.end () - 1);
+  for (uint32_t i = 0; i < m_phys.size (); ++i)
+    {
+      m_cellPhys[fill[m_cellOf[i]]++] = i;
+    }
+}
+
+void
+GridYansWifiChannel::Send (Ptr<GridYansWifiPhy> sender, Ptr<const Packet> packet,
+                           double txPowerDbm, Time duration)
+{
+  if (!m_built || Simulator::Now () > m_validUntil)
+    {
+      Rebuild ();
+    }
+  Ptr<MobilityModel> senderMobility = sender->GetMobility ();
+  NS_ASSERT (senderMobility != 0);
+
+  if (m_cell == 0)
+    {
+      for (uint32_t i = 0; i < m_phys.size (); ++i)
+        {
+          Deliver (sender, senderMobility, i, packet, txPowerDbm, duration);
+        }
+      return;
+    }
+
+  // PHYs of the 3x3 cells around the sender, in PHY order as
+  // YansWifiChannel would visit them
+  uint32_t cell = m_cellOf[sender->GetGridIndex ()];
+  int64_t cx = cell % m_nx;
+  int64_t cy = cell / m_nx;
+  m_candidates.clear ();
+  for (int64_t y = std::max<int64_t> (0, cy - 1); y <= std::min<int64_t> (m_ny - 1, cy + 1); ++y)
+    {
+      for (int64_t x = std::max<int64_t> (0, cx - 1); x <= std::min<int64_t> (m_nx - 1, cx + 1); ++x)
+        {
+          uint32_t c = y * m_nx + x;
+          m_candidates.insert (m_candidates.end (),
+                               m_cellPhys.begin () + m_cellStart[c],
+                               m_cellPhys.begin () + m_cellStart[c + 1]);
+        }
+    }
+  std::sort (m_candidates.begin (), m_candidates.end ());
+  m_skipped += m_phys.size () - m_candidates.size ();
+  for (uint32_t k = 0; k < m_candidates.size (); ++k)
+    {
+      Deliver (sender, senderMobility, m_candidates[k], packet, txPowerDbm, duration);
+    }
+}
+
+void
+GridYansWifiChannel::Deliver (Ptr<GridYansWifiPhy> sender, Ptr<MobilityModel> senderMobility,
+                              uint32_t index, Ptr<const Packet> packet, double txPowerDbm,
+                              Time duration)
+{
+  Ptr<GridYansWifiPhy> phy = m_phys[index];
+  //For now don't account for inter channel interference nor channel bonding
+  if (phy == sender || phy->GetChannelNumber () != sender->GetChannelNumber ())
+    {
+      return;
+    }
+  if (m_skipAsleep && phy->IsStateSleep ())
+    {
+      // would be dropped on arrival; a radio waking up within the
+      // propagation delay misses the frame
+      ++m_asleep;
+      return;
+    }
+  ++m_evaluated;
+  Ptr<MobilityModel> receiverMobility = phy->GetMobility ()->GetObject<MobilityModel> ();
+  Time delay = m_delay->GetDelay (senderMobility, receiverMobility);
+  double rxPowerDbm = m_loss->CalcRxPower (txPowerDbm, senderMobility, receiverMobility);
+  Ptr<Packet> copy = packet->Copy ();
+  Ptr<NetDevice> dstNetDevice = phy->GetDevice ();
+  uint32_t dstNode = dstNetDevice == 0 ? 0xffffffff : dstNetDevice->GetNode ()->GetId ();
+  Simulator::ScheduleWithContext (dstNode, delay, &GridYansWifiChannel::Receive,
+                                  Ptr<YansWifiPhy> (phy), copy, rxPowerDbm, duration);
+}
+
+void
+GridYansWifiChannel::Receive (Ptr<YansWifiPhy> phy, Ptr<Packet> packet, double rxPowerDbm, Time duration)
+{
+  // same early drop as YansWifiChannel::Receive
+  if ((rxPowerDbm + phy->GetRxGain ()) < phy->GetEdThreshold ())
+    {
+      return;
+    }
+  phy->StartReceivePreamble (packet, DbmToW (rxPowerDbm + phy->GetRxGain ()), duration);
+}
+
+TypeId
+GridYansWifiPhy::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::GridYansWifiPhy")
+    .SetParent<YansWifiPhy> ()
+    .SetGroupName ("Wifi")
+    .AddConstructor<GridYansWifiPhy> ()
+  ;
+  return tid;
+}
+
+GridYansWifiPhy::GridYansWifiPhy ()
+  : m_gridIndex (0)
+{
+}
+
+GridYansWifiPhy::~GridYansWifiPhy ()
+{
+}
+
+void
+GridYansWifiPhy::DoDispose (void)
+{
+  m_gridChannel = 0;
+  YansWifiPhy::DoDispose ();
+}
+
+void
+GridYansWifiPhy::SetGridChannel (Ptr<GridYansWifiChannel> channel, uint32_t index)
+{
+  m_gridChannel = channel;
+  m_gridIndex = index;
+}
+
+uint32_t
+GridYansWifiPhy::GetGridIndex (void) const
+{
+  return m_gridIndex;
+}
+
+void
+GridYansWifiPhy::StartTx (Ptr<Packet> packet, WifiTxVector txVector, Time txDuration)
+{
+  NS_ABORT_MSG_IF (m_gridChannel == 0, "GridYansWifiPhy without a GridYansWifiChannel");
+  m_gridChannel->Send (this, packet, GetPowerDbm (txVector.GetTxPowerLevel ()) + GetTxGain (),
+                       txDuration);
+}
+
+GridYansWifiPhyHelper::GridYansWifiPhyHelper (const YansWifiPhyHelper &phy,
+                                              Ptr<GridYansWifiChannel> channel)
+  : YansWifiPhyHelper (phy),
+    m_gridChannel (channel)
+{
+  m_phy.SetTypeId (GridYansWifiPhy::GetTypeId ());
+  SetChannel (channel);
+}
+
+Ptr<WifiPhy>
+GridYansWifiPhyHelper::Create (Ptr<Node> node, Ptr<NetDevice> device) const
+{
+  // YansWifiPhyHelper::Create is private, so the PHY is put together
+  // here the same way
+  Ptr<GridYansWifiPhy> phy = m_phy.Create<GridYansWifiPhy> ();
+  NS_ABORT_MSG_IF (phy == 0, "GridYansWifiPhyHelper did not create a GridYansWifiPhy");
+  Ptr<ErrorRateModel> error = m_errorRateModel.Create<ErrorRateModel> ();
+  phy->SetErrorRateModel (error);
+  if (m_frameCaptureModel.IsTypeIdSet ())
+    {
+      Ptr<FrameCaptureModel> capture = m_frameCaptureModel.Create<FrameCaptureModel> ();
+      phy->SetFrameCaptureModel (capture);
+    }
+  if (m_preambleDetectionModel.IsTypeIdSet ())
+    {
+      Ptr<PreambleDetectionModel> detection = m_preambleDetectionModel.Create<PreambleDetectionModel> ();
+      phy->SetPreambleDetectionModel (detection);
+    }
+  phy->SetChannel (m_gridChannel);
+  phy->SetDevice (device);
+  m_gridChannel->AddGridPhy (phy);
+  return phy;
+}
+
+} // namespace ns3
+
+#endif /* LY_GRID_YANS_WIFI_CHANNEL_H */
@@ -0,0 +1,405 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Radio energy of many nodes, computed when asked for.
+//
+// BasicEnergySource and WifiRadioEnergyModel update the remaining
+// energy on every PHY state change and on a periodic event per node.
+// This account only sums, per node and state, the durations the
+// WifiPhyStateHelper "State" trace reports; the energy is
+//
+//   V * sum over states (current of the state * time in it)
+//
+// evaluated when GetTotalEnergyConsumption() or GetRemainingEnergy() is
+// called, with the time since the last logged period charged to the
+// PHY's current state.  Durations are kept as one array per state
+// (struct of arrays), so a sweep over all nodes reads contiguous memory.
+//
+// Depletion is predicted instead of polled: no node can run out before
+// the smallest remaining energy divided by V times the largest current
+// has passed, so a single check is scheduled then, and again after it
+// as long as energy is left.  A radio that runs out is switched off, as
+// WifiRadioEnergyModel does, unless a depletion callback is set.
+//
+// The attributes carry the names and defaults of WifiRadioEnergyModel
+// and BasicEnergySource.
+//
+#ifndef LY_LAZY_RADIO_ENERGY_H
+#define LY_LAZY_RADIO_ENERGY_H
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "ns3/abort.h"
+#include "ns3/callback.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/net-device-container.h"
+#include "ns3/object.h"
+#include "ns3/pointer.h"
+#include "ns3/simulator.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/wifi-phy.h"
+#include "ns3/wifi-phy-state.h"
+#include "ns3/wifi-phy-state-helper.h"
+
+namespace ns3 {
+
+class LazyRadioEnergy : public Object
+{
+public:
+  /// states accounted, in WifiPhyState order
+  static const uint32_t STATES = 7;
+
+  static TypeId GetTypeId (void);
+
+  LazyRadioEnergy ();
+  virtual ~LazyRadioEnergy ();
+
+  /**
+   * Account the radios of these WiFi devices from now on.
+   * \param devices one WifiNetDevice per node
+   */
+  void Install (NetDeviceContainer devices);
+  /**
+   * \param callback called with the device index instead of switching
+   *        the PHY off when a radio runs out of energy
+   */
+  void SetDepletionCallback (Callback<void, uint32_t> callback);
+
+  uint32_t GetN (void) const;
+  Ptr<WifiPhy> GetPhy (uint32_t i) const;
+  double GetInitialEnergy (void) const;
+  /// \return J consumed by radio i up to now
+  double GetTotalEnergyConsumption (uint32_t i) const;
+  double GetRemainingEnergy (uint32_t i) const;
+  /// \return seconds radio i spent in state up to now
+  double GetStateTime (uint32_t i, WifiPhyState state) const;
+  /// \return current drawn in state (A)
+  double GetCurrent (WifiPhyState state) const;
+  double GetVoltage (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  static void StateLogged (LazyRadioEnergy *account, uint32_t i,
+                           Time start, Time duration, WifiPhyState state);
+  void ScheduleCheck (void);
+  void CheckDepletion (void);
+
+  static LogComponent g_log;            //!< for the NS_LOG macros
+
+  double m_voltage;
+  double m_initialEnergy;
+  double m_idleCurrent;
+  double m_ccaBusyCurrent;
+  double m_txCurrent;
+  double m_rxCurrent;
+  double m_switchingCurrent;
+  double m_sleepCurrent;
+
+  std::vector<Ptr<WifiPhy> > m_phys;
+  std::vector<Ptr<WifiPhyStateHelper> > m_states;
+  std::vector<double> m_seconds[STATES];   //!< logged time per state, one array per state
+  std::vector<double> m_loggedUntil;       //!< end of the last logged period (s)
+  std::vector<uint8_t> m_lastState;        //!< state of that period
+  std::vector<uint8_t> m_depleted;
+  Callback<void, uint32_t> m_depletion;
+  EventId m_check;
+};
+
+LogComponent LazyRadioEnergy::g_log ("LazyRadioEnergy", __FILE__);
+
+TypeId
+LazyRadioEnergy::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LazyRadioEnergy")
+    .SetParent<Object> ()
+    .SetGroupName ("Energy")
+    .AddConstructor<LazyRadioEnergy> ()
+    .AddAttribute ("SupplyVoltageV", "Supply voltage of every radio's source.",
+                   DoubleValue (3.0),
+                   MakeDoubleAccessor (&LazyRadioEnergy::m_voltage),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("BasicEnergySourceInitialEnergyJ", "Initial energy of every radio, 0 = no depletion.",
+                   DoubleValue (10.0),
+                   MakeDoubleAccessor (&LazyRadioEnergy::m_initialEnergy),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("IdleCurrentA", "The default radio Idle current in Ampere.",
+                   DoubleValue (0.273),
+                   MakeDoubleAccessor (&LazyRadioEnergy::m_idleCurrent),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("CcaBusyCurrentA", "The default radio CCA Busy State current in Ampere.",
+                   DoubleValue (0.273),
+                   MakeDoubleAccessor (&LazyRadioEnergy::m_ccaBusyCurrent),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("TxCurrentA", "The radio Tx current in Ampere.",
+                   DoubleValue (0.380),
+                   MakeDoubleAccessor (&LazyRadioEnergy::m_txCurrent),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("RxCurrentA", "The radio Rx current in Ampere.",
+                   DoubleValue (0.313),
+                   MakeDoubleAccessor (&LazyRadioEnergy::m_rxCurrent),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("SwitchingCurrentA", "The default radio Channel Switch current in Ampere.",
+                   DoubleValue (0.273),
+                   MakeDoubleAccessor (&LazyRadioEnergy::m_switchingCurrent),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("SleepCurrentA", "The radio Sleep current in Ampere.",
+                   DoubleValue (0.033),
+                   MakeDoubleAccessor (&LazyRadioEnergy::m_sleepCurrent),
+                   MakeDoubleChecker<double> (0))
+  ;
+  return tid;
+}
+
+LazyRadioEnergy::LazyRadioEnergy ()
+  : m_voltage (0),
+    m_initialEnergy (0),
+    m_idleCurrent (0),
+    m_ccaBusyCurrent (0),
+    m_txCurrent (0),
+    m_rxCurrent (0),
+    m_switchingCurrent (0),
+    m_sleepCurrent (0)
+{
+}
+
+LazyRadioEnergy::~LazyRadioEnergy ()
+{
+}
+
+void
+LazyRadioEnergy::DoDispose (void)
+{
+  m_check.Cancel ();
+  m_phys.clear ();
+  m_states.clear ();
+  m_depletion = MakeNullCallback<void, uint32_t> ();
+  Object::DoDispose ();
+}
+
+void
+LazyRadioEnergy::Install (NetDeviceContainer devices)
+{
+  uint32_t n = devices.GetN ();
+  m_phys.clear ();
+  m_states.clear ();
+  for (uint32_t s = 0; s < STATES; ++s)
+    {
+      m_seconds[s].assign (n, 0.0);
+    }
+  m_loggedUntil.assign (n, Simulator::Now ().GetSeconds ());
+  m_lastState.assign (n, IDLE);
+  m_depleted.assign (n, 0);
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      Ptr<WifiNetDevice> device = DynamicCast<WifiNetDevice> (devices.Get (i));
+      NS_ABORT_MSG_IF (device == 0, "LazyRadioEnergy needs WifiNetDevices");
+      Ptr<WifiPhy> phy = device->GetPhy ();
+      PointerValue state;
+      phy->GetAttribute ("State", state);
+      Ptr<WifiPhyStateHelper> helper = state.Get<WifiPhyStateHelper> ();
+      NS_ABORT_MSG_IF (helper == 0, "PHY " << i << " has no state helper");
+      helper->TraceConnectWithoutContext
+        ("State", MakeBoundCallback (&LazyRadioEnergy::StateLogged, this, i));
+      m_phys.push_back (phy);
+      m_states.push_back (helper);
+    }
+  ScheduleCheck ();
+}
+
+void
+LazyRadioEnergy::SetDepletionCallback (Callback<void, uint32_t> callback)
+{
+  m_depletion = callback;
+}
+
+void
+LazyRadioEnergy::StateLogged (LazyRadioEnergy *account, uint32_t i,
+                              Time start, Time duration, WifiPhyState state)
+{
+  // periods arrive in order: idle and CCA busy when they end, TX when
+  // it starts, with its full duration
+  if (state >= STATES)
+    {
+      return;
+    }
+  account->m_seconds[state][i] += duration.GetSeconds ();
+  account->m_loggedUntil[i] = (start + duration).GetSeconds ();
+  account->m_lastState[i] = state;
+}
+
+uint32_t
+LazyRadioEnergy::GetN (void) const
+{
+  return m_phys.size ();
+}
+
+Ptr<WifiPhy>
+LazyRadioEnergy::GetPhy (uint32_t i) const
+{
+  return m_phys[i];
+}
+
+double
+LazyRadioEnergy::GetInitialEnergy (void) const
+{
+  return m_initialEnergy;
+}
+
+double
+LazyRadioEnergy::GetVoltage (void) const
+{
+  return m_voltage;
+}
+
+double
+LazyRadioEnergy::GetCurrent (WifiPhyState state) const
+{
+  switch (state)
+    {
+    case IDLE:
+      return m_idleCurrent;
+    case CCA_BUSY:
+      return m_ccaBusyCurrent;
+    case TX:
+      return m_txCurrent;
+    case RX:
+      return m_rxCurrent;
+    case SWITCHING:
+      return m_switchingCurrent;
+    case SLEEP:
+      return m_sleepCurrent;
+    default:
+      return 0.0;    // off
+    }
+}
+
+double
+LazyRadioEnergy::GetStateTime (uint32_t i, WifiPhyState state) const
+{
+  if (state >= STATES)
+    {
+      return 0.0;
+    }
+  double now = Simulator::Now ().GetSeconds ();
+  double seconds = m_seconds[state][i];
+  if (m_loggedUntil[i] > now)
+    {
+      // a TX period was logged in full when it started
+      if (m_lastState[i] == state)
+        {
+          seconds -= m_loggedUntil[i] - now;
+        }
+    }
+  else if (m_states[i]->GetState () == state)
+    {
+      seconds += now - m_loggedUntil[i];
+    }
+  return seconds;
+}
+
+double
+LazyRadioEnergy::GetTotalEnergyConsumption (uint32_t i) const
+{
+  double charge = 0;
+  for (uint32_t s = 0; s < STATES; ++s)
+    {
+      charge += GetCurrent (static_cast<WifiPhyState> (s)) * m_seconds[s][i];
+    }
+  double now = Simulator::Now ().GetSeconds ();
+  if (m_loggedUntil[i] > now)
+    {
+      charge -= GetCurrent (static_cast<WifiPhyState> (m_lastState[i])) * (m_loggedUntil[i] - now);
+    }
+  else
+    {
+      charge += GetCurrent (m_states[i]->GetState ()) * (now - m_loggedUntil[i]);
+    }
+  return m_voltage * charge;
+}
+
+double
+LazyRadioEnergy::GetRemainingEnergy (uint32_t i) const
+{
+  return std::max (0.0, m_initialEnergy - GetTotalEnergyConsumption (i));
+}
+
+void
+LazyRadioEnergy::ScheduleCheck (void)
+{
+  m_check.Cancel ();
+  if (m_initialEnergy <= 0 || m_phys.empty ())
+    {
+      return;
+    }
+  double maxCurrent = 0;
+  for (uint32_t s = 0; s < STATES; ++s)
+    {
+      maxCurrent = std::max (maxCurrent, GetCurrent (static_cast<WifiPhyState> (s)));
+    }
+  if (maxCurrent <= 0)
+    {
+      return;
+    }
+  double least = std::numeric_limits<double>::max ();
+  for (uint32_t i = 0; i < m_phys.size (); ++i)
+    {
+      if (!m_depleted[i])
+        {
+          least = std::min (least, GetRemainingEnergy (i));
+        }
+    }
+  if (least == std::numeric_limits<double>::max ())
+    {
+      return;
+    }
+  // no radio drains faster than at the largest current; never wait less
+  // than a microsecond so a nearly empty radio is not checked in a loop
+  double seconds = std::max (least / (m_voltage * maxCurrent), 1e-6);
+  m_check = Simulator::Schedule (Seconds (seconds), &LazyRadioEnergy::CheckDepletion, this);
+}
+
+void
+LazyRadioEnergy::CheckDepletion (void)
+{
+  for (uint32_t i = 0; i < m_phys.size (); ++i)
+    {
+      if (!m_depleted[i] && GetTotalEnergyConsumption (i) >= m_initialEnergy * (1 - 1e-9))
+        {
+          m_depleted[i] = 1;
+          NS_LOG_INFO ("radio " << i << " depleted at " << Simulator::Now ().GetSeconds () << "s");
+          if (m_depletion.IsNull ())
+            {
+              m_phys[i]->SetOffMode ();
+            }
+          else
+            {
+              m_depletion (i);
+            }
+        }
+    }
+  ScheduleCheck ();
+}
+
+} // namespace ns3
+
+#endif /* LY_LAZY_RADIO_ENERGY_H */
@@ -0,0 +1,193 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Data rate the rate manager chose on every link.
+//
+// The MonitorSnifferTx trace of each PHY reports the TXVECTOR of every
+// frame sent.  Unicast data frames (including retries) are counted per
+// link, transmitter node to the node owning the receiver address, with
+// the sum, minimum and maximum of their data rate.  Output() writes
+//
+//   link[<tx>-<rx>] <key>-frames   frames sent on the link
+//   link[<tx>-<rx>] <key>-mean     mean data rate (Mbit/s)
+//   link[<tx>-<rx>] <key>-min      lowest data rate used (Mbit/s)
+//   link[<tx>-<rx>] <key>-max      highest data rate used (Mbit/s)
+//
+// for every link that carried data, in link order.
+//
+#ifndef LY_LINK_RATE_CALCULATOR_H
+#define LY_LINK_RATE_CALCULATOR_H
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "ns3/abort.h"
+#include "ns3/callback.h"
+#include "ns3/mac48-address.h"
+#include "ns3/net-device-container.h"
+#include "ns3/packet.h"
+#include "ns3/stats-module.h"
+#include "ns3/wifi-mac-header.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/wifi-phy.h"
+#include "ns3/wifi-tx-vector.h"
+
+namespace ns3 {
+
+class LinkRateCalculator : public DataCalculator
+{
+public:
+  static TypeId GetTypeId (void);
+
+  LinkRateCalculator ();
+  virtual ~LinkRateCalculator ();
+
+  /**
+   * Record the data frames these devices send from now on.
+   * \param devices WifiNetDevices; receivers outside them are not
+   *        counted
+   */
+  void Install (NetDeviceContainer devices);
+
+  /// \return data frames sent from node tx to node rx
+  uint32_t GetFrames (uint32_t tx, uint32_t rx) const;
+  /// \return their mean data rate (bit/s), 0 if none
+  double GetMeanRate (uint32_t tx, uint32_t rx) const;
+
+  virtual void Output (DataOutputCallback &callback) const;
+
+private:
+  struct Link
+  {
+    uint32_t frames;
+    double sum;        //!< bit/s
+    uint64_t min;
+    uint64_t max;
+  };
+  typedef std::pair<uint32_t, uint32_t> LinkId;
+
+  static void Sniff (LinkRateCalculator *calc, uint32_t node, Ptr<const Packet> packet,
+                     uint16_t channelFreqMhz, WifiTxVector txVector, MpduInfo aMpdu);
+
+  std::map<Mac48Address, uint32_t> m_nodeOf;
+  std::map<LinkId, Link> m_links;
+};
+
+TypeId
+LinkRateCalculator::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LinkRateCalculator")
+    .SetParent<DataCalculator> ()
+    .SetGroupName ("Stats")
+    .AddConstructor<LinkRateCalculator> ()
+  ;
+  return tid;
+}
+
+LinkRateCalculator::LinkRateCalculator ()
+{
+}
+
+LinkRateCalculator::~LinkRateCalculator ()
+{
+}
+
+void
+LinkRateCalculator::Install (NetDeviceContainer devices)
+{
+  for (NetDeviceContainer::Iterator it = devices.Begin (); it != devices.End (); ++it)
+    {
+      Ptr<WifiNetDevice> device = DynamicCast<WifiNetDevice> (*it);
+      NS_ABORT_MSG_IF (device == 0, "LinkRateCalculator needs WifiNetDevices");
+      m_nodeOf[Mac48Address::ConvertFrom (device->GetAddress ())] = device->GetNode ()->GetId ();
+    }
+  for (NetDeviceContainer::Iterator it = devices.Begin (); it != devices.End (); ++it)
+    {
+      Ptr<WifiNetDevice> device = DynamicCast<WifiNetDevice> (*it);
+      device->GetPhy ()->TraceConnectWithoutContext
+        ("MonitorSnifferTx",
+         MakeBoundCallback (&LinkRateCalculator::Sniff, this, device->GetNode ()->GetId ()));
+    }
+}
+
+void
+LinkRateCalculator::Sniff (LinkRateCalculator *calc, uint32_t node, Ptr<const Packet> packet,
+                           uint16_t channelFreqMhz, WifiTxVector txVector, MpduInfo aMpdu)
+{
+  WifiMacHeader mac;
+  if (packet->PeekHeader (mac) == 0 || !mac.IsData () || mac.GetAddr1 ().IsGroup ())
+    {
+      return;
+    }
+  std::map<Mac48Address, uint32_t>::const_iterator rx = calc->m_nodeOf.find (mac.GetAddr1 ());
+  if (rx == calc->m_nodeOf.end ())
+    {
+      return;
+    }
+  uint64_t rate = txVector.GetMode ().GetDataRate (txVector);
+  std::pair<std::map<LinkId, Link>::iterator, bool> inserted =
+    calc->m_links.insert (std::make_pair (LinkId (node, rx->second), Link ()));
+  Link &link = inserted.first->second;
+  if (inserted.second)
+    {
+      link.frames = 0;
+      link.sum = 0;
+      link.min = rate;
+      link.max = rate;
+    }
+  ++link.frames;
+  link.sum += rate;
+  link.min = std::min (link.min, rate);
+  link.max = std::max (link.max, rate);
+}
+
+uint32_t
+LinkRateCalculator::GetFrames (uint32_t tx, uint32_t rx) const
+{
+  std::map<LinkId, Link>::const_iterator it = m_links.find (LinkId (tx, rx));
+  return it != m_links.end () ? it->second.frames : 0;
+}
+
+double
+LinkRateCalculator::GetMeanRate (uint32_t tx, uint32_t rx) const
+{
+  std::map<LinkId, Link>::const_iterator it = m_links.find (LinkId (tx, rx));
+  return it != m_links.end () ? it->second.sum / it->second.frames : 0.0;
+}
+
+void
+LinkRateCalculator::Output (DataOutputCallback &callback) const
+{
+  for (std::map<LinkId, Link>::const_iterator it = m_links.begin (); it != m_links.end (); ++it)
+    {
+      std::ostringstream context;
+      context << "link[" << it->first.first << "-" << it->first.second << "]";
+      const Link &link = it->second;
+      callback.OutputSingleton (context.str (), m_key + "-frames", link.frames);
+      callback.OutputSingleton (context.str (), m_key + "-mean", link.sum / link.frames / 1e6);
+      callback.OutputSingleton (context.str (), m_key + "-min", link.min / 1e6);
+      callback.OutputSingleton (context.str (), m_key + "-max", link.max / 1e6);
+    }
+}
+
+} // namespace ns3
+
+#endif /* LY_LINK_RATE_CALCULATOR_H */
@@ -68,30 +68,93 @@
 //
 // tcpdump -r wifi-simple-adhoc-grid-0-0.pcap -nn -tt
 //
+// A whole parameter sweep can be run from one command; every grid point
+// and replication runs as its own worker process and the results are
+// merged into one omnet file (rerun the same command to resume):
+//
+// ./waf --run "ly2017210600 --sweep=distance=500,1000;numNodes=25,100 --replications=5 --jobs=32 --sweepOutput=sweep.sca"
+//
+// With --format=columnar the results are written to <prefix>.lycol
+// for ly2017210600StatsRead.  A sweep takes the format from the
+// extension of --sweepOutput: sweep.lycol runs columnar workers.
+//
+// --warmup=T runs the routing warm-up once and forks --warmupForks
+// replications from it (RngRun, RngRun+1, ...), each writing
+// <prefix>-f<k> outputs; flow start times and the 33 s run then count
+// from T, so a child's run ends at T + 33 s.  The batteries get the
+// most a radio can draw during the warm-up on top of their 30 J, so no
+// radio is depleted by the warm-up, and <prefix>-f<k>-energy.txt only
+// counts the energy used after the fork:
+//
+// ./waf --run "ly2017210600 --warmup=30 --warmupForks=10 --flows=random:20 --format=columnar"
+//
+// --profile charges the wall time of every event to its type and
+// writes <prefix>-profile.folded for flamegraph.pl, plus a table of
+// the 20 most expensive event types:
+//
+// ./waf --run "ly2017210600 --profile --profileSample=16"
+// flamegraph.pl profile.folded > profile.svg
+//
+// --amsdu=N lets the MAC put frames queued to the same next hop into one
+// A-MSDU of up to N bytes, one channel access and one ACK for all of
+// them.  ns-3 only aggregates between HT stations, so it needs an
+// HtMcs phyMode (the standard follows the phyMode):
+//
+// ./waf --run "ly2017210600 --phyMode=HtMcs0 --amsdu=7935"
+//
+// Broadcast control traffic is already batched: OLSR sends the HELLO,
+// TC and MID messages it has queued in one packet.
+//
+// --rateManager=ideal, minstrel or aarf adapts the data rate of every
+// link instead of sending everything at phyMode; the rate each link
+// used is written as link[<tx>-<rx>] link-rate-mbps-* statistics:
+//
+// ./waf --run "ly2017210600 --rateManager=ideal"
+//
+// --energyBreakdown adds node[N] radio-energy-* statistics: the radio
+// energy of every node by PHY state and by the role of the frames it
+// sent and received (source, relay, sink, other).
+//
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 #include <vector>
 #include <string>
 #include "ns3/command-line.h"
 #include "ns3/config.h"
 #include "ns3/uinteger.h"
+#include "ns3/boolean.h"
 #include "ns3/double.h"
 #include "ns3/string.h"
 #include "ns3/log.h"
+#include "ns3/rng-seed-manager.h"
 #include "ns3/yans-wifi-helper.h"
 #include "ns3/mobility-helper.h"
 #include "ns3/ipv4-address-helper.h"
 #include "ns3/yans-wifi-channel.h"
 #include "ns3/mobility-model.h"
-#include "ns3/olsr-helper.h"
-#include "ns3/aodv-helper.h"
-#include "ns3/ipv4-static-routing-helper.h"
-#include "ns3/ipv4-list-routing-helper.h"
+#include "ns3/ipv4-routing-helper.h"
 #include "ns3/internet-stack-helper.h"
 #include "ns3/netanim-module.h"
 #include "ns3/temp.h"
 #include "ns3/energy-module.h"
 #include "ns3/wifi-radio-energy-model-helper.h"
+#include "sweep-runner.h"
+#include "flow-table.h"
+#include "node-trace-counters.h"
+#include "anim-record-writer.h"
+#include "columnar-data-output.h"
+#include "energy-sampler.h"
+#include "lazy-radio-energy.h"
+#include "radio-energy-breakdown.h"
+#include "radio-duty-cycle.h"
+#include "link-rate-calculator.h"
+#include "grid-yans-wifi-channel.h"
+#include "cached-propagation-models.h"
+#include "warmup-fork.h"
+#include "packet-pool.h"
+#include "profiling-scheduler.h"
+#include "routing-registry.h"
 
 using namespace ns3;
 using namespace std;
@@ -121,18 +184,50 @@ static void GenerateTraffic (Ptr<Socket> socket, uint32_t pktSize,
     }
 }
 
-void TxCallback (Ptr<CounterCalculator<uint32_t> > datac,
-                 std::string path, Ptr<const Packet> packet) {
-  NS_LOG_INFO ("Sent frame counted in " <<
-               datac->GetKey ());
-  datac->Update ();
-  // end TxCallback
+// 无线最大功耗 (W)：供电电压乘以 WifiRadioEnergyModel 各状态电流中的最大值
+static double MaxRadioPower (double txCurrent)
+{
+  Ptr<WifiRadioEnergyModel> model = CreateObject<WifiRadioEnergyModel> ();
+  model->SetAttribute ("TxCurrentA", DoubleValue (txCurrent));
+  static const char *currents[] = { "IdleCurrentA", "CcaBusyCurrentA", "TxCurrentA",
+                                    "RxCurrentA", "SwitchingCurrentA", "SleepCurrentA" };
+  double most = 0;
+  for (uint32_t k = 0; k < sizeof (currents) / sizeof (currents[0]); ++k)
+    {
+      DoubleValue current;
+      model->GetAttribute (currents[k], current);
+      most = std::max (most, current.Get ());
+    }
+  DoubleValue voltage;
+  CreateObject<BasicEnergySource> ()->GetAttribute ("BasicEnergySupplyVoltageV", voltage);
+  return voltage.Get () * most;
 }
 
+// 由 phyMode 名称推出物理层标准
+static WifiPhyStandard StandardOfMode (std::string phyMode)
+{
+  if (phyMode.compare (0, 4, "Dsss") == 0 || phyMode.compare (0, 3, "Cck") == 0)
+    {
+      return WIFI_PHY_STANDARD_80211b;
+    }
+  if (phyMode.compare (0, 7, "ErpOfdm") == 0)
+    {
+      return WIFI_PHY_STANDARD_80211g;
+    }
+  if (phyMode.compare (0, 5, "HtMcs") == 0)
+    {
+      return WIFI_PHY_STANDARD_80211n_2_4GHZ;
+    }
+  NS_ABORT_MSG ("No 2.4 GHz standard for phyMode " << phyMode);
+  return WIFI_PHY_STANDARD_80211b;
+}
 
 int main (int argc, char *argv[])
 {
   std::string phyMode ("DsssRate1Mbps");
+  uint32_t amsdu = 0; // bytes, 0 = one MSDU per frame
+  double staticMinPsr = 0.9;//static 路由：链路所需的分组成功率
+  string rateManager ("constant");//constant、ideal、minstrel 或 aarf
   double distance =1000;  // m
   uint32_t packetSize = 1000; // bytes
   uint32_t numPackets = 1;
@@ -148,16 +243,56 @@ int main (int argc, char *argv[])
   string strategy ("wifi-default");//要检查的代码或参数，本例中固定
   string input;//是具体问题，本例中是两个节点之间的距离
   string runID;//本次实验唯一标识符，其信息在以后的分析中被标记，以>提供识别
+  string prefix ("data");//输出文件前缀
+  string flowSpec;//流表文件，或 random:N
+  string traffic;//cbr、poisson、onoff:on:off 或 trace:file，空则用 Sender
+  bool packetPool = false;
+  bool profile = false;
+  uint32_t profileSample = 1;
+  uint32_t gridWidth = 10;
+  string traceNodes ("flows");//flows 或 all
+  bool anim = true;
+  string animFormat ("xml");//xml 或 bin
+  string animFile ("ly4-3289");
+  string animNodes;//例如 0-9,90-99
+  string animFlows;//流编号，例如 0,3
+  double animFlush = 1.0; // seconds
+  double animWindow = 0; // seconds, 0 = one file
+  uint32_t animSegmentMb = 0; // 0 = no size limit
+  uint64_t animMaxPkts = 99999999999999ULL;
+  double energySample = 0; // seconds, 0 = final values only
+  uint32_t energyRows = 256;
+  string energyModel ("ns3");//ns3 或 lazy
+  bool energyBreakdown = false;
+  double dutyCycle = 1.0; // awake part of each period, 1 = always on
+  double dutyPeriod = 2.0; // seconds, the OLSR HelloInterval
+  bool skipAsleep = false;
+  string channel ("yans");//yans 或 grid
+  bool propCache = false;
+  double warmup = 0; // seconds, 0 = no shared warm-up
+  uint32_t warmupForks = 1;
+  //参数扫描
+  string sweep;
+  string sweepOutput ("sweep.sca");
+  uint32_t replications = 1;
+  uint32_t jobs = 0;
 
   {
+    // the pid keeps runs started in the same second apart
     stringstream sstr;
-    sstr << "run-" << time (NULL);
+    sstr << "run-" << time (NULL) << "-" << getpid ();
     runID = sstr.str ();//本实验的标识符
   }
 
 
   CommandLine cmd;
   cmd.AddValue ("phyMode", "Wifi Phy mode", phyMode);
+  cmd.AddValue ("staticMinPsr", "strategy=static: success rate of a 1000-byte packet a link needs.",
+                staticMinPsr);
+  cmd.AddValue ("rateManager", "Rate control: constant (phyMode on every link), ideal, minstrel or aarf.",
+                rateManager);
+  cmd.AddValue ("amsdu", "Largest A-MSDU (bytes, up to 7935) of frames queued to the same next hop; needs an HtMcs phyMode (0 = off).",
+                amsdu);
   cmd.AddValue ("distance", "distance (m)", distance);
   cmd.AddValue ("packetSize", "size of application packet sent", packetSize);
   cmd.AddValue ("numPackets", "number of packets generated", numPackets);
@@ -168,17 +303,99 @@ int main (int argc, char *argv[])
   cmd.AddValue ("sinkNode", "Receiver node number", sinkNode);
   cmd.AddValue ("sourceNode", "Sender node number", sourceNode);
 //New cmd.AddValue
-  cmd.AddValue ("format", "Format to use for data output.",
+  cmd.AddValue ("format", "Format to use for data output: omnet, columnar or db.",
                 format);
   cmd.AddValue ("experiment", "Identifier for experiment.",
                 experiment);
-  cmd.AddValue ("strategy", "Identifier for strategy.",
+  cmd.AddValue ("strategy", "Routing protocol, also the strategy label: olsr (wifi-default), aodv, dsdv or static.",
                 strategy);
   cmd.AddValue ("run", "Identifier for run.",
                 runID);
+  cmd.AddValue ("prefix", "File prefix for data and energy output.",
+                prefix);
+  cmd.AddValue ("anim", "Write the NetAnim trace.", anim);
+  cmd.AddValue ("animFormat", "Animation output: xml (NetAnim) or bin (compact stream).",
+                animFormat);
+  cmd.AddValue ("animFile", "Animation file name without extension.", animFile);
+  cmd.AddValue ("animNodes", "bin only: record frames of these nodes, e.g. 0-9,90-99.",
+                animNodes);
+  cmd.AddValue ("animFlows", "bin only: record data frames of these flow numbers, e.g. 0,3.",
+                animFlows);
+  cmd.AddValue ("animFlush", "bin only: seconds of simulated time between flushes.",
+                animFlush);
+  cmd.AddValue ("animWindow", "bin only: start a new segment file every this many seconds.",
+                animWindow);
+  cmd.AddValue ("animSegmentMb", "bin only: start a new segment file after this many MB.",
+                animSegmentMb);
+  cmd.AddValue ("animMaxPkts", "xml only: packets per NetAnim file before it rotates.",
+                animMaxPkts);
+  cmd.AddValue ("channel", "yans, or grid to skip receivers beyond detection range.",
+                channel);
+  cmd.AddValue ("propCache", "Cache loss and delay of node pairs that do not move.",
+                propCache);
+  cmd.AddValue ("warmup", "Run routing alone for this many seconds, then fork the replications.",
+                warmup);
+  cmd.AddValue ("warmupForks", "Replications continuing from one warm-up (RngRun, RngRun+1, ...).",
+                warmupForks);
+  cmd.AddValue ("energySample", "Seconds between energy samples written to <prefix>-energy.lyts (0 = off).",
+                energySample);
+  cmd.AddValue ("energyRows", "Energy samples buffered in memory before they are written.",
+                energyRows);
+  cmd.AddValue ("dutyCycle", "Part of every period the radios are awake (1 = no sleep).",
+                dutyCycle);
+  cmd.AddValue ("dutyPeriod", "Seconds between synchronized wake-ups; keep it the OLSR HelloInterval.",
+                dutyPeriod);
+  cmd.AddValue ("skipAsleep", "channel=grid: schedule no receptions at sleeping radios (no PhyRxDrop, no interference).",
+                skipAsleep);
+  cmd.AddValue ("energyModel", "ns3 (energy sources and radio models) or lazy (computed from PHY state times when read).",
+                energyModel);
+  cmd.AddValue ("energyBreakdown", "Write the radio energy of every node by PHY state and traffic role.",
+                energyBreakdown);
+  cmd.AddValue ("flows", "Flow file (src dst start interval size count per line) or random:N.",
+                flowSpec);
+  cmd.AddValue ("traffic", "Traffic generator of flows that name none: cbr, poisson, onoff:<on>:<off> or trace:<file>.",
+                traffic);
+  cmd.AddValue ("packetPool", "Recycle the packets of --traffic senders (packet uids repeat).",
+                packetPool);
+  cmd.AddValue ("profile", "Time every event type; writes <prefix>-profile.folded and a top-20 table.",
+                profile);
+  cmd.AddValue ("profileSample", "Time one event in this many when profiling.",
+                profileSample);
+  cmd.AddValue ("gridWidth", "Nodes per grid row.", gridWidth);
+  cmd.AddValue ("traceNodes", "Nodes whose MAC frame counters are written: flows or all.",
+                traceNodes);
+  cmd.AddValue ("sweep", "Sweep grid, e.g. \"distance=500,1000;strategy=olsr,aodv\".",
+                sweep);
+  cmd.AddValue ("sweepOutput", "Merged output of a sweep: .sca (omnet) or .lycol (columnar).",
+                sweepOutput);
+  cmd.AddValue ("replications", "Replications per sweep point.",
+                replications);
+  cmd.AddValue ("jobs", "Concurrent sweep workers or warm-up forks (0 = one per core).",
+                jobs);
 
   cmd.Parse (argc, argv);
 
+  if (!sweep.empty ())
+    {
+      // Each point of the grid re-executes this program as a worker.
+      SweepRunner runner;
+      runner.SetGrid (sweep);
+      runner.SetReplications (replications);
+      runner.SetBaseRun (RngSeedManager::GetRun ());
+      runner.SetJobs (jobs);
+      runner.SetOutput (sweepOutput);
+      return runner.Run (argc, argv);
+    }
+
+  if (profile)
+    {
+      // 性能剖析：按事件类型统计耗时
+      ObjectFactory scheduler;
+      scheduler.SetTypeId ("ns3::ProfilingScheduler");
+      scheduler.Set ("Sample", UintegerValue (profileSample));
+      Simulator::SetScheduler (scheduler);
+    }
+
    #ifndef STATS_HAS_SQLITE3
   if (format == "db") {
       NS_LOG_ERROR ("sqlite support not compiled in.");
@@ -215,15 +432,20 @@ int main (int argc, char *argv[])
     }
 
   YansWifiPhyHelper wifiPhy =  YansWifiPhyHelper::Default ();
+  // 传播缓存的距离上限也由这几个值算出
+  const double rxGain = -10.0;        // dB
+  const double txGain = 0.0;          // dB
+  const double txPower = 16.0206;     // dBm
+  const double edThreshold = -101.0;  // dBm
   // set it to zero; otherwise, gain will be added
-  wifiPhy.Set ("RxGain", DoubleValue (-10.0) );
-  wifiPhy.Set ("TxGain", DoubleValue (0.0) );
+  wifiPhy.Set ("RxGain", DoubleValue (rxGain) );
+  wifiPhy.Set ("TxGain", DoubleValue (txGain) );
   wifiPhy.Set ("CcaMode1Threshold", DoubleValue (-62.0)); 
 
-  wifiPhy.Set ("TxPowerStart", DoubleValue(16.0206));
+  wifiPhy.Set ("TxPowerStart", DoubleValue(txPower));
   wifiPhy.Set ("RxNoiseFigure", DoubleValue(0.0));
-  wifiPhy.Set ("TxPowerEnd", DoubleValue(16.0206));
-  wifiPhy.Set ("EnergyDetectionThreshold", DoubleValue(-101.0));
+  wifiPhy.Set ("TxPowerEnd", DoubleValue(txPower));
+  wifiPhy.Set ("EnergyDetectionThreshold", DoubleValue(edThreshold));
 
   // ns-3 supports RadioTap and Prism tracing extensions for 802.11b
   wifiPhy.SetPcapDataLinkType (WifiPhyHelper::DLT_IEEE802_11_RADIO);
@@ -234,17 +456,102 @@ int main (int argc, char *argv[])
  // wifiChannel.AddPropagationLoss ("ns3::LogDistancePropagationLossModel");
 //		  "ReferenceDistance",DoubleValue(100.0),
 //		  "ReferenceLoss",DoubleValue(-86.6779));
-  wifiPhy.SetChannel (wifiChannel.Create ());
+  // same models as the helper above, optionally behind a cache of the
+  // static node pairs
+  Ptr<FriisPropagationLossModel> friis = CreateObject<FriisPropagationLossModel> ();
+  Ptr<PropagationLossModel> loss = friis;
+  Ptr<PropagationDelayModel> delay = CreateObject<ConstantSpeedPropagationDelayModel> ();
+  if (propCache)
+    {
+      // the yans channel asks for every pair: keep only the pairs within
+      // detection range of the PHYs configured above
+      double range = GridYansWifiChannel::FriisRange (friis, txPower + txGain, rxGain, edThreshold);
+      Ptr<CachedPropagationLossModel> cachedLoss = CreateObject<CachedPropagationLossModel> ();
+      cachedLoss->SetInner (loss);
+      cachedLoss->GetCache ().SetMaxDistance (range);
+      loss = cachedLoss;
+      Ptr<CachedPropagationDelayModel> cachedDelay = CreateObject<CachedPropagationDelayModel> ();
+      cachedDelay->SetInner (delay);
+      cachedDelay->GetCache ().SetMaxDistance (range);
+      delay = cachedDelay;
+    }
+  Ptr<GridYansWifiChannel> gridChannel;
+  NS_ABORT_MSG_IF (skipAsleep && channel != "grid", "--skipAsleep needs --channel=grid");
+  if (channel == "grid")
+    {
+      // receivers out of range are culled
+      gridChannel = CreateObject<GridYansWifiChannel> ();
+      gridChannel->SetPropagationDelayModel (delay);
+      gridChannel->SetPropagationLossModel (loss);
+      gridChannel->SetSkipAsleep (skipAsleep);
+    }
+  else
+    {
+      Ptr<YansWifiChannel> yansChannel = wifiChannel.Create ();
+      if (propCache)
+        {
+          yansChannel->SetPropagationDelayModel (delay);
+          yansChannel->SetPropagationLossModel (loss);
+        }
+      wifiPhy.SetChannel (yansChannel);
+    }
 
-  // Add an upper mac and disable rate control
+  // Add an upper mac; rate control is off unless --rateManager says otherwise
   WifiMacHelper wifiMac;
-  wifi.SetStandard (WIFI_PHY_STANDARD_80211b);
-  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
-                                "DataMode",StringValue (phyMode),
-                                "ControlMode",StringValue (phyMode));
+  WifiPhyStandard standard = StandardOfMode (phyMode);
+  wifi.SetStandard (standard);
+  // HT 模式下控制帧仍用非 HT 速率
+  string controlMode = standard == WIFI_PHY_STANDARD_80211n_2_4GHZ ? "ErpOfdmRate6Mbps" : phyMode;
+  if (rateManager == "constant")
+    {
+      wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
+                                    "DataMode",StringValue (phyMode),
+                                    "ControlMode",StringValue (controlMode));
+    }
+  else if (rateManager == "ideal")
+    {
+      // 按上次收到该邻居帧的 SNR（Friis 损耗）选最高可用速率
+      wifi.SetRemoteStationManager ("ns3::IdealWifiManager");
+    }
+  else if (rateManager == "minstrel")
+    {
+      wifi.SetRemoteStationManager (standard == WIFI_PHY_STANDARD_80211n_2_4GHZ
+                                    ? "ns3::MinstrelHtWifiManager" : "ns3::MinstrelWifiManager");
+    }
+  else if (rateManager == "aarf")
+    {
+      wifi.SetRemoteStationManager ("ns3::AarfWifiManager");
+    }
+  else
+    {
+      NS_ABORT_MSG ("Unknown rate manager " << rateManager);
+    }
   // Set it to adhoc mode
-  wifiMac.SetType ("ns3::AdhocWifiMac");
-  NetDeviceContainer devices = wifi.Install (wifiPhy, wifiMac, c);
+  if (amsdu > 0)
+    {
+      // 聚合：发往同一下一跳的排队帧合成一个 A-MSDU，只需一次信道竞争和一个 ACK
+      NS_ABORT_MSG_IF (standard != WIFI_PHY_STANDARD_80211n_2_4GHZ,
+                       "--amsdu needs an HT phyMode such as HtMcs0, not " << phyMode);
+      NS_ABORT_MSG_IF (amsdu > 7935, "An HT A-MSDU holds at most 7935 bytes");
+      wifiMac.SetType ("ns3::AdhocWifiMac",
+                       "QosSupported", BooleanValue (true),
+                       "BE_MaxAmsduSize", UintegerValue (amsdu),
+                       "BE_MaxAmpduSize", UintegerValue (0));
+    }
+  else
+    {
+      wifiMac.SetType ("ns3::AdhocWifiMac");
+    }
+  NetDeviceContainer devices;
+  if (gridChannel != 0)
+    {
+      GridYansWifiPhyHelper gridPhy (wifiPhy, gridChannel);
+      devices = wifi.Install (gridPhy, wifiMac, c);
+    }
+  else
+    {
+      devices = wifi.Install (wifiPhy, wifiMac, c);
+    }
 
   MobilityHelper mobility;
   mobility.SetPositionAllocator ("ns3::GridPositionAllocator",
@@ -252,7 +559,7 @@ int main (int argc, char *argv[])
                                  "MinY", DoubleValue (0.0),
                                  "DeltaX", DoubleValue (distance),
                                  "DeltaY", DoubleValue (distance),
-                                 "GridWidth", UintegerValue (10),
+                                 "GridWidth", UintegerValue (gridWidth),
                                  "LayoutType", StringValue ("RowFirst"));
   mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
  
@@ -264,47 +571,82 @@ int main (int argc, char *argv[])
 
    /** Energy Model **/
   /***************************************************************************/
-  /* energy source */
-  BasicEnergySourceHelper basicSourceHelper;
-  // configure energy source
-  basicSourceHelper.Set ("BasicEnergySourceInitialEnergyJ", DoubleValue (30));//初始电量
-  // install source
-  EnergySourceContainer sources = basicSourceHelper.Install (c);
-  /* device energy model */
-  WifiRadioEnergyModelHelper radioEnergyHelper;
-  // configure radio energy model 无线发射电流
-  radioEnergyHelper.Set ("TxCurrentA", DoubleValue (0.0174));
-  // install device model
-  DeviceEnergyModelContainer deviceModels = radioEnergyHelper.Install (devices, sources);
-
+  NS_ABORT_MSG_IF (energyModel != "ns3" && energyModel != "lazy",
+                   "Unknown energy model " << energyModel);
+  EnergySourceContainer sources;
+  DeviceEnergyModelContainer deviceModels;
+  Ptr<LazyRadioEnergy> lazyEnergy;
+  // 初始电量；预热时再加上预热期间最多可能消耗的能量，预热中不会耗尽
+  double initialEnergy = 30 + warmup * MaxRadioPower (0.0174);
+  if (energyModel == "lazy")
+    {
+      // 不装能量源和设备模型：只记录 PHY 状态时长，读取时才计算能耗
+      lazyEnergy = CreateObject<LazyRadioEnergy> ();
+      lazyEnergy->SetAttribute ("BasicEnergySourceInitialEnergyJ", DoubleValue (initialEnergy));//初始电量
+      lazyEnergy->SetAttribute ("TxCurrentA", DoubleValue (0.0174));
+      lazyEnergy->Install (devices);
+    }
+  else
+    {
+      /* energy source */
+      BasicEnergySourceHelper basicSourceHelper;
+      // configure energy source
+      basicSourceHelper.Set ("BasicEnergySourceInitialEnergyJ", DoubleValue (initialEnergy));//初始电量
+      // install source
+      sources = basicSourceHelper.Install (c);
+      /* device energy model */
+      WifiRadioEnergyModelHelper radioEnergyHelper;
+      // configure radio energy model 无线发射电流
+      radioEnergyHelper.Set ("TxCurrentA", DoubleValue (0.0174));
+      // install device model
+      deviceModels = radioEnergyHelper.Install (devices, sources);
+    }
+  // 各状态时长：lazy 模型自己记录；否则仅在需要能耗分解时另装一个只记时长、不判耗尽的账户
+  Ptr<LazyRadioEnergy> radioStates = lazyEnergy;
+  if (radioStates == 0 && energyBreakdown)
+    {
+      radioStates = CreateObject<LazyRadioEnergy> ();
+      radioStates->SetAttribute ("BasicEnergySourceInitialEnergyJ", DoubleValue (0));
+      radioStates->SetAttribute ("TxCurrentA", DoubleValue (0.0174));
+      radioStates->Install (devices);
+    }
+  // 能耗曲线：按固定间隔采样剩余能量和功率
+  EnergySampler energySampler;
+  if (energySample > 0)
+    {
+      energySampler.SetInterval (Seconds (energySample), energyRows);
+      if (lazyEnergy != 0)
+        {
+          energySampler.Install (lazyEnergy);
+        }
+      else
+        {
+          energySampler.Install (sources, deviceModels);
+        }
+      if (warmup <= 0)
+        {
+          energySampler.Open (prefix == "data" ? "energy.lyts" : prefix + "-energy.lyts");
+        }
+    }
 
-  //********************OLSR协议****************************
-  // Enable OLSR
-  
-  OlsrHelper olsr;//Creating a Olsr
-  Ipv4StaticRoutingHelper staticRouting;//Create a StaticRouting
+  // 占空比：所有无线同时醒来，每个周期只监听一部分时间
+  RadioDutyCycle dutySchedule;
+  dutySchedule.SetSchedule (Seconds (dutyPeriod), dutyCycle);
+  dutySchedule.Install (devices, Seconds (0));
 
-  Ipv4ListRoutingHelper list;//Create a routinglist
-  list.Add (staticRouting, 0);//set the staticrouting priority to 0
-  list.Add (olsr, 10);//set the olsr priority to 10
+  //********************路由协议****************************
+  // --strategy selects the protocol: olsr (wifi-default), aodv, dsdv or
+  // static (shortest paths from the channel, no control traffic)
+  RoutingRegistry routing;
+  NextHopMatrixRoutingHelper staticRouting;
+  staticRouting.SetMinSuccessRate (staticMinPsr);
+  routing.Add ("static", staticRouting);
+  Ipv4ListRoutingHelper list = routing.GetListRouting (strategy);//static 优先级 0，所选协议 10
 
   InternetStackHelper internet;
   internet.SetRoutingHelper (list); // has effect on the next Install ()
-  //internet.SetRoutingHelper;//another method to set the "olsr" routing
-  internet.Install (c);
-  
- 
- /* 
-  AodvHelper aodv;
-  Ipv4StaticRoutingHelper staticRouting;
-  Ipv4ListRoutingHelper list;
-  list.Add (staticRouting, 0);
-  list.Add (aodv, 10);
-  InternetStackHelper internet;
-  internet.SetRoutingHelper (list);
   internet.Install (c);
-*/
-  
+
 
   Ipv4AddressHelper ipv4;
   NS_LOG_INFO ("Assign IP Addresses.");
@@ -328,11 +670,9 @@ int main (int argc, char *argv[])
       wifiPhy.EnablePcap ("wifi-simple-adhoc-grid", devices);
       // Trace routing tables
       Ptr<OutputStreamWrapper> routingStream = Create<OutputStreamWrapper> ("wifi-simple-adhoc-grid.routes", std::ios::out);
-    //  aodv.PrintRoutingTableAllEvery (Seconds (2), routingStream);
-     olsr.PrintRoutingTableAllEvery (Seconds (2), routingStream);
+      Ipv4RoutingHelper::PrintRoutingTableAllEvery (Seconds (2), routingStream);
       Ptr<OutputStreamWrapper> neighborStream = Create<OutputStreamWrapper> ("wifi-simple-adhoc-grid.neighbors", std::ios::out);
-    //  aodv.PrintNeighborCacheAllEvery (Seconds (2), neighborStream);
-     olsr.PrintNeighborCacheAllEvery (Seconds (2), neighborStream);
+      Ipv4RoutingHelper::PrintNeighborCacheAllEvery (Seconds (2), neighborStream);
 
       // To do-- enable an IP-level trace that shows forwarding events only
     }
@@ -344,163 +684,55 @@ int main (int argc, char *argv[])
   // Output what we are doing
  // NS_LOG_UNCOND ("Testing from node " << sourceNode << " to " << sinkNode << " with grid distance " << distance);
 
+  if (warmup > 0)
+    {
+      // 路由预热：只跑一次，各次重复实验从同一状态继续
+      NS_ABORT_MSG_IF (tracing, "--tracing cannot be combined with --warmup");
+      Simulator::Stop (Seconds (warmup));
+      Simulator::Run ();
+      WarmupFork fork;
+      fork.SetForks (warmupForks);
+      fork.SetJobs (jobs);
+      fork.SetBaseRun (RngSeedManager::GetRun ());
+      fork.SetPrefix (prefix);
+      int replication = fork.Fork ();
+      if (replication < 0)
+        {
+          return fork.GetFailed () == 0 ? 0 : 1;
+        }
+      stringstream suffix;
+      suffix << "-f" << replication;
+      prefix += suffix.str ();
+      runID += suffix.str ();
+      animFile += suffix.str ();
+      if (energySample > 0)
+        {
+          energySampler.Open (prefix + "-energy.lyts");
+        }
+    }
+  // 分叉时各无线已消耗的能量，结果只统计之后的部分
+  uint32_t radios = lazyEnergy != 0 ? lazyEnergy->GetN () : deviceModels.GetN ();
+  vector<double> warmupConsumed (radios, 0.0);
+  for (uint32_t k = 0; warmup > 0 && k < radios; ++k)
+    {
+      warmupConsumed[k] = lazyEnergy != 0 ? lazyEnergy->GetTotalEnergyConsumption (k)
+                                          : deviceModels.Get (k)->GetTotalEnergyConsumption ();
+    }
+
   //------------------------------------------------------------
   //-- Create a custom traffic source and sink
   //-------------------------------------------
-  //0-90-
-  NS_LOG_INFO ("Create traffic source & sink.");
-  Ptr<Node> appSource0 = NodeList::GetNode (0);
-  Ptr<Sender> sender0 = CreateObject<Sender>();//发送器sender
-  appSource0->AddApplication (sender0);
-  sender0->SetStartTime (Seconds (1));
-
-  Ptr<Node> appSink0 = NodeList::GetNode (90);
-  Ptr<Receiver> receiver0 = CreateObject<Receiver>();//接收器receiver
-  appSink0->AddApplication (receiver0);
-  receiver0->SetStartTime (Seconds (0));
-
-  Config::Set ("/NodeList/0/ApplicationList/*/$Sender/Destination",
-               Ipv4AddressValue ("10.1.1.91"));
-  //Config::Set可以更改节点发送数据包的目的地，本例中默认设置为广播
-  
-  //1-91
-  NS_LOG_INFO ("Create traffic source & sink.");
-  Ptr<Node> appSource = NodeList::GetNode (1);
-  Ptr<Sender> sender = CreateObject<Sender>();//发送器sender
-  appSource->AddApplication (sender);
-  sender->SetStartTime (Seconds (3));
-
-  Ptr<Node> appSink = NodeList::GetNode (91);
-  Ptr<Receiver> receiver = CreateObject<Receiver>();//接收器receiver
-  appSink->AddApplication (receiver);
-  receiver->SetStartTime (Seconds (0));
-
-  Config::Set ("/NodeList/1/ApplicationList/*/$Sender/Destination",
-               Ipv4AddressValue ("10.1.1.92"));
-  //Config::Set可以更改节点发送数据包的目的地，本例中默认设置为广播
-
-
-  //2-92
-   NS_LOG_INFO ("Create traffic source & sink.");
-  Ptr<Node> appSource2 = NodeList::GetNode (2);
-  Ptr<Sender> sender2 = CreateObject<Sender>();//发送器sender
-  appSource2->AddApplication (sender2);
-  sender2->SetStartTime (Seconds (5));
-
-  Ptr<Node> appSink2 = NodeList::GetNode (92);
-  Ptr<Receiver> receiver2 = CreateObject<Receiver>();//接收器receiver
-  appSink2->AddApplication (receiver2);
-  receiver2->SetStartTime (Seconds (0));
-
-  Config::Set ("/NodeList/2/ApplicationList/*/$Sender/Destination",
-               Ipv4AddressValue ("10.1.1.93"));
-
-
-  //3-93
- NS_LOG_INFO ("Create traffic source & sink.");
-  Ptr<Node> appSource3 = NodeList::GetNode (3);
-  Ptr<Sender> sender3 = CreateObject<Sender>();//发送器sender
-  appSource3->AddApplication (sender3);
-  sender3->SetStartTime (Seconds (8));
-
-  Ptr<Node> appSink3 = NodeList::GetNode (93);
-  Ptr<Receiver> receiver3 = CreateObject<Receiver>();//接收器receiver
-  appSink3->AddApplication (receiver3);
-  receiver3->SetStartTime (Seconds (0));
-
-  Config::Set ("/NodeList/3/ApplicationList/*/$Sender/Destination",
-               Ipv4AddressValue ("10.1.1.94"));
-
-  //4-94
- NS_LOG_INFO ("Create traffic source & sink.");
-  Ptr<Node> appSource4 = NodeList::GetNode (4);
-  Ptr<Sender> sender4 = CreateObject<Sender>();//发送器sender
-  appSource4->AddApplication (sender4);
-  sender4->SetStartTime (Seconds (11));
-
-  Ptr<Node> appSink4 = NodeList::GetNode (94);
-  Ptr<Receiver> receiver4 = CreateObject<Receiver>();//接收器receiver
-  appSink4->AddApplication (receiver4);
-  receiver4->SetStartTime (Seconds (0));
-
-  Config::Set ("/NodeList/4/ApplicationList/*/$Sender/Destination",
-               Ipv4AddressValue ("10.1.1.95"));
-
-  //5-95
- NS_LOG_INFO ("Create traffic source & sink.");
-  Ptr<Node> appSource5 = NodeList::GetNode (5);
-  Ptr<Sender> sender5 = CreateObject<Sender>();//发送器sender
-  appSource5->AddApplication (sender5);
-  sender5->SetStartTime (Seconds (14));
-
-  Ptr<Node> appSink5 = NodeList::GetNode (95);
-  Ptr<Receiver> receiver5 = CreateObject<Receiver>();//接收器receiver
-  appSink5->AddApplication (receiver5);
-  receiver5->SetStartTime (Seconds (0));
-
-  Config::Set ("/NodeList/5/ApplicationList/*/$Sender/Destination",
-               Ipv4AddressValue ("10.1.1.96"));
-
-  //6-96
- NS_LOG_INFO ("Create traffic source & sink.");
-  Ptr<Node> appSource6 = NodeList::GetNode (6);
-  Ptr<Sender> sender6 = CreateObject<Sender>();//发送器sender
-  appSource6->AddApplication (sender6);
-  sender6->SetStartTime (Seconds (17));
-
-  Ptr<Node> appSink6 = NodeList::GetNode (96);
-  Ptr<Receiver> receiver6 = CreateObject<Receiver>();//接收器receiver
-  appSink6->AddApplication (receiver6);
-  receiver6->SetStartTime (Seconds (0));
-
-  Config::Set ("/NodeList/6/ApplicationList/*/$Sender/Destination",
-               Ipv4AddressValue ("10.1.1.97"));
-
-  //7-97
- NS_LOG_INFO ("Create traffic source & sink.");
-  Ptr<Node> appSource7 = NodeList::GetNode (7);
-  Ptr<Sender> sender7 = CreateObject<Sender>();//发送器sender
-  appSource7->AddApplication (sender7);
-  sender7->SetStartTime (Seconds (20));
-
-  Ptr<Node> appSink7 = NodeList::GetNode (97);
-  Ptr<Receiver> receiver7 = CreateObject<Receiver>();//接收器receiver
-  appSink7->AddApplication (receiver7);
-  receiver7->SetStartTime (Seconds (0));
-
-  Config::Set ("/NodeList/7/ApplicationList/*/$Sender/Destination",
-               Ipv4AddressValue ("10.1.1.98"));
-
-  //8-98
- NS_LOG_INFO ("Create traffic source & sink.");
-  Ptr<Node> appSource8 = NodeList::GetNode (8);
-  Ptr<Sender> sender8 = CreateObject<Sender>();//发送器sender
-  appSource8->AddApplication (sender8);
-  sender8->SetStartTime (Seconds (23));
-
-  Ptr<Node> appSink8 = NodeList::GetNode (98);
-  Ptr<Receiver> receiver8 = CreateObject<Receiver>();//接收器receiver
-  appSink8->AddApplication (receiver8);
-  receiver8->SetStartTime (Seconds (0));
-
-  Config::Set ("/NodeList/8/ApplicationList/*/$Sender/Destination",
-               Ipv4AddressValue ("10.1.1.99"));
-
-  //9-99
- NS_LOG_INFO ("Create traffic source & sink.");
-  Ptr<Node> appSource9 = NodeList::GetNode (9);
-  Ptr<Sender> sender9 = CreateObject<Sender>();//发送器sender
-  appSource9->AddApplication (sender9);
-  sender9->SetStartTime (Seconds (26));
-
-  Ptr<Node> appSink9 = NodeList::GetNode (99);
-  Ptr<Receiver> receiver9 = CreateObject<Receiver>();//接收器receiver
-  appSink9->AddApplication (receiver9);
-  receiver9->SetStartTime (Seconds (0));
-
-  Config::Set ("/NodeList/9/ApplicationList/*/$Sender/Destination",
-               Ipv4AddressValue ("10.1.1.100"));
-
+  NS_LOG_INFO ("Create traffic sources & sinks.");
+  FlowTable flows;
+  flows.Configure (flowSpec, numNodes, gridWidth);
+  flows.SetTraffic (traffic);
+  Ptr<PacketPool> pool;
+  if (packetPool)
+    {
+      pool = Create<PacketPool> ();
+      flows.SetPacketPool (pool);
+    }
+  flows.Install (c, i);
 
 
   //------------------------------------------------------------
@@ -518,592 +750,113 @@ int main (int argc, char *argv[])
   data.AddMetadata ("author", "2017210600-liyi");//
 
 
-// Create a counter to track how many frames are generated.  Updates
-  // are triggered by the trace signal generated by the WiFi MAC model
-  // object.  Here we connect the counter to the signal via the simple
-  // TxCallback() glue function defined above.
-  Ptr<CounterCalculator<uint32_t> > totalTx0 =
-    CreateObject<CounterCalculator<uint32_t> >();//计数器totalTx-发>送frames
-  totalTx0->SetKey ("wifi-tx-frames");
-  totalTx0->SetContext ("node[0]");
-  Config::Connect ("/NodeList/0/DeviceList/*/$ns3::WifiNetDevice/Mac/MacTx",
-                   MakeBoundCallback (&TxCallback, totalTx0));
-  data.AddDataCalculator (totalTx0);
-
-
-  Ptr<CounterCalculator<uint32_t> > totalTx =
-    CreateObject<CounterCalculator<uint32_t> >();//计数器totalTx-发>送frames
+  // Count the frames every node's WiFi MAC sends and receives.  The
+  // counters are bound directly to the MacTx/MacRx trace sources of
+  // each WifiMac and kept in one array per counter.  Only flow
+  // endpoints are written out unless --traceNodes=all.
+  Ptr<NodeCounterCalculator> totalTx =
+    CreateObject<NodeCounterCalculator>();//计数器totalTx-发送frames
   totalTx->SetKey ("wifi-tx-frames");
-  totalTx->SetContext ("node[1]");
-  Config::Connect ("/NodeList/1/DeviceList/*/$ns3::WifiNetDevice/Mac/MacTx",
-                   MakeBoundCallback (&TxCallback, totalTx));
+  totalTx->SetNodes (numNodes);
+  totalTx->ConnectMac (devices, "MacTx");
   data.AddDataCalculator (totalTx);
 
-
-  //2-92
-Ptr<CounterCalculator<uint32_t> > totalTx2 =
-    CreateObject<CounterCalculator<uint32_t> >();//计数器totalTx-发>送frames
-  totalTx2->SetKey ("wifi-tx-frames");
-  totalTx2->SetContext ("node[2]");
-  Config::Connect ("/NodeList/2/DeviceList/*/$ns3::WifiNetDevice/Mac/MacTx",
-                   MakeBoundCallback (&TxCallback, totalTx2));
-  data.AddDataCalculator (totalTx2);
-
-  //3-93
-Ptr<CounterCalculator<uint32_t> > totalTx3 =
-    CreateObject<CounterCalculator<uint32_t> >();//计数器totalTx-发>送frames
-  totalTx3->SetKey ("wifi-tx-frames");
-  totalTx3->SetContext ("node[3]");
-  Config::Connect ("/NodeList/3/DeviceList/*/$ns3::WifiNetDevice/Mac/MacTx",
-                   MakeBoundCallback (&TxCallback, totalTx3));
-  data.AddDataCalculator (totalTx3);
-
-  //4-94
-Ptr<CounterCalculator<uint32_t> > totalTx4 =
-    CreateObject<CounterCalculator<uint32_t> >();//计数器totalTx-发>送frames
-  totalTx4->SetKey ("wifi-tx-frames");
-  totalTx4->SetContext ("node[4]");
-  Config::Connect ("/NodeList/4/DeviceList/*/$ns3::WifiNetDevice/Mac/MacTx",
-                   MakeBoundCallback (&TxCallback, totalTx4));
-  data.AddDataCalculator (totalTx4);
-
-  //5-95
-Ptr<CounterCalculator<uint32_t> > totalTx5 =
-    CreateObject<CounterCalculator<uint32_t> >();//计数器totalTx-发>送frames
-  totalTx5->SetKey ("wifi-tx-frames");
-  totalTx5->SetContext ("node[5]");
-  Config::Connect ("/NodeList/5/DeviceList/*/$ns3::WifiNetDevice/Mac/MacTx",
-                   MakeBoundCallback (&TxCallback, totalTx5));
-  data.AddDataCalculator (totalTx5);
-
-  //6-96
-Ptr<CounterCalculator<uint32_t> > totalTx6 =
-    CreateObject<CounterCalculator<uint32_t> >();//计数器totalTx-发>送frames
-  totalTx6->SetKey ("wifi-tx-frames");
-  totalTx6->SetContext ("node[6]");
-  Config::Connect ("/NodeList/6/DeviceList/*/$ns3::WifiNetDevice/Mac/MacTx",
-                   MakeBoundCallback (&TxCallback, totalTx6));
-  data.AddDataCalculator (totalTx6);
-
-  //7-97
-Ptr<CounterCalculator<uint32_t> > totalTx7 =
-    CreateObject<CounterCalculator<uint32_t> >();//计数器totalTx-发>送frames
-  totalTx7->SetKey ("wifi-tx-frames");
-  totalTx7->SetContext ("node[7]");
-  Config::Connect ("/NodeList/7/DeviceList/*/$ns3::WifiNetDevice/Mac/MacTx",
-                   MakeBoundCallback (&TxCallback, totalTx7));
-  data.AddDataCalculator (totalTx7);
-
-  //8-98
-Ptr<CounterCalculator<uint32_t> > totalTx8 =
-    CreateObject<CounterCalculator<uint32_t> >();//计数器totalTx-发>送frames
-  totalTx8->SetKey ("wifi-tx-frames");
-  totalTx8->SetContext ("node[8]");
-  Config::Connect ("/NodeList/8/DeviceList/*/$ns3::WifiNetDevice/Mac/MacTx",
-                   MakeBoundCallback (&TxCallback, totalTx8));
-  data.AddDataCalculator (totalTx8);
-
-  //9-99
-Ptr<CounterCalculator<uint32_t> > totalTx9 =
-    CreateObject<CounterCalculator<uint32_t> >();//计数器totalTx-发>送frames
-  totalTx9->SetKey ("wifi-tx-frames");
-  totalTx9->SetContext ("node[9]");
-  Config::Connect ("/NodeList/9/DeviceList/*/$ns3::WifiNetDevice/Mac/MacTx",
-                   MakeBoundCallback (&TxCallback, totalTx9));
-  data.AddDataCalculator (totalTx9);
-
-
-   // This is similar, but creates a counter to track how many frames
-  // are received.  Instead of our own glue function, this uses a
-  // method of an adapter class to connect a counter directly to the
-  // trace signal generated by the WiFi MAC.
-  Ptr<PacketCounterCalculator> totalRx0 =
-    CreateObject<PacketCounterCalculator>();//totalRx-接受frames
-  totalRx0->SetKey ("wifi-rx-frames");
-  totalRx0->SetContext ("node[90]");
-  Config::Connect ("/NodeList/90/DeviceList/*/$ns3::WifiNetDevice/Mac/MacRx",
-                   MakeCallback (&PacketCounterCalculator::PacketUpdate,
-                                 totalRx0));
-  data.AddDataCalculator (totalRx0);
-
-
-  Ptr<PacketCounterCalculator> totalRx =
-    CreateObject<PacketCounterCalculator>();//totalRx-接受frames
+  Ptr<NodeCounterCalculator> totalRx =
+    CreateObject<NodeCounterCalculator>();//totalRx-接受frames
   totalRx->SetKey ("wifi-rx-frames");
-  totalRx->SetContext ("node[91]");
-  Config::Connect ("/NodeList/91/DeviceList/*/$ns3::WifiNetDevice/Mac/MacRx",
-                   MakeCallback (&PacketCounterCalculator::PacketUpdate,
-                                 totalRx));
+  totalRx->SetNodes (numNodes);
+  totalRx->ConnectMac (devices, "MacRx");
   data.AddDataCalculator (totalRx);
 
+  if (traceNodes == "all")
+    {
+      totalTx->SelectAll ();
+      totalRx->SelectAll ();
+    }
+  else
+    {
+      for (uint32_t f = 0; f < flows.GetN (); ++f)
+        {
+          totalTx->Select (flows.Get (f).src);
+          totalRx->Select (flows.Get (f).dst);
+        }
+    }
 
-  //2-92
-Ptr<PacketCounterCalculator> totalRx2 =
-    CreateObject<PacketCounterCalculator>();//totalRx-接受frames
-  totalRx2->SetKey ("wifi-rx-frames");
-  totalRx2->SetContext ("node[92]");
-  Config::Connect ("/NodeList/92/DeviceList/*/$ns3::WifiNetDevice/Mac/MacRx",
-                   MakeCallback (&PacketCounterCalculator::PacketUpdate,
-                                 totalRx2));
-  data.AddDataCalculator (totalRx2);
-
-  //3-93
-Ptr<PacketCounterCalculator> totalRx3 =
-    CreateObject<PacketCounterCalculator>();//totalRx-接受frames
-  totalRx3->SetKey ("wifi-rx-frames");
-  totalRx3->SetContext ("node[93]");
-  Config::Connect ("/NodeList/93/DeviceList/*/$ns3::WifiNetDevice/Mac/MacRx",
-                   MakeCallback (&PacketCounterCalculator::PacketUpdate,
-                                 totalRx3));
-  data.AddDataCalculator (totalRx3);
-
-  //4-94
-Ptr<PacketCounterCalculator> totalRx4 =
-    CreateObject<PacketCounterCalculator>();//totalRx-接受frames
-  totalRx4->SetKey ("wifi-rx-frames");
-  totalRx4->SetContext ("node[94]");
-  Config::Connect ("/NodeList/94/DeviceList/*/$ns3::WifiNetDevice/Mac/MacRx",
-                   MakeCallback (&PacketCounterCalculator::PacketUpdate,
-                                 totalRx4));
-  data.AddDataCalculator (totalRx4);
-
-  //5-95
-Ptr<PacketCounterCalculator> totalRx5 =
-    CreateObject<PacketCounterCalculator>();//totalRx-接受frames
-  totalRx5->SetKey ("wifi-rx-frames");
-  totalRx5->SetContext ("node[95]");
-  Config::Connect ("/NodeList/95/DeviceList/*/$ns3::WifiNetDevice/Mac/MacRx",
-                   MakeCallback (&PacketCounterCalculator::PacketUpdate,
-                                 totalRx5));
-  data.AddDataCalculator (totalRx5);
-
-  //6-96
-Ptr<PacketCounterCalculator> totalRx6 =
-    CreateObject<PacketCounterCalculator>();//totalRx-接受frames
-  totalRx6->SetKey ("wifi-rx-frames");
-  totalRx6->SetContext ("node[96]");
-  Config::Connect ("/NodeList/96/DeviceList/*/$ns3::WifiNetDevice/Mac/MacRx",
-                   MakeCallback (&PacketCounterCalculator::PacketUpdate,
-                                 totalRx6));
-  data.AddDataCalculator (totalRx6);
-
-  //7-97
-Ptr<PacketCounterCalculator> totalRx7 =
-    CreateObject<PacketCounterCalculator>();//totalRx-接受frames
-  totalRx7->SetKey ("wifi-rx-frames");
-  totalRx7->SetContext ("node[97]");
-  Config::Connect ("/NodeList/97/DeviceList/*/$ns3::WifiNetDevice/Mac/MacRx",
-                   MakeCallback (&PacketCounterCalculator::PacketUpdate,
-                                 totalRx7));
-  data.AddDataCalculator (totalRx7);
-
-  //8-98
-Ptr<PacketCounterCalculator> totalRx8 =
-    CreateObject<PacketCounterCalculator>();//totalRx-接受frames
-  totalRx8->SetKey ("wifi-rx-frames");
-  totalRx8->SetContext ("node[98]");
-  Config::Connect ("/NodeList/98/DeviceList/*/$ns3::WifiNetDevice/Mac/MacRx",
-                   MakeCallback (&PacketCounterCalculator::PacketUpdate,
-                                 totalRx8));
-  data.AddDataCalculator (totalRx8);
-
-  //9-99
-Ptr<PacketCounterCalculator> totalRx9 =
-    CreateObject<PacketCounterCalculator>();//totalRx-接受frames
-  totalRx9->SetKey ("wifi-rx-frames");
-  totalRx9->SetContext ("node[99]");
-  Config::Connect ("/NodeList/99/DeviceList/*/$ns3::WifiNetDevice/Mac/MacRx",
-                   MakeCallback (&PacketCounterCalculator::PacketUpdate,
-                                 totalRx9));
-  data.AddDataCalculator (totalRx9);
-
-
- // This counter tracks how many packets---as opposed to frames---are
-  // generated.  This is connected directly to a trace signal provided
-  // by our Sender class.
-  Ptr<PacketCounterCalculator> appTx0 =
-    CreateObject<PacketCounterCalculator>();
-  appTx0->SetKey ("sender-tx-packets");
-  appTx0->SetContext ("node[0]");
-  Config::Connect ("/NodeList/0/ApplicationList/*/$Sender/Tx",
-                   MakeCallback (&PacketCounterCalculator::PacketUpdate,
-                                 appTx0));
-  data.AddDataCalculator (appTx0);
-
-  Ptr<PacketCounterCalculator> appTx =
-    CreateObject<PacketCounterCalculator>();
-  appTx->SetKey ("sender-tx-packets");
-  appTx->SetContext ("node[1]");
-  Config::Connect ("/NodeList/1/ApplicationList/*/$Sender/Tx",
-                   MakeCallback (&PacketCounterCalculator::PacketUpdate,
-                                 appTx));
-  data.AddDataCalculator (appTx);
-
-  //2-92
- Ptr<PacketCounterCalculator> appTx2 =
-    CreateObject<PacketCounterCalculator>();
-  appTx2->SetKey ("sender-tx-packets");
-  appTx2->SetContext ("node[2]");
-  Config::Connect ("/NodeList/2/ApplicationList/*/$Sender/Tx",
-                   MakeCallback (&PacketCounterCalculator::PacketUpdate,
-                                 appTx2));
-  data.AddDataCalculator (appTx2);
-
-  //3-93
- Ptr<PacketCounterCalculator> appTx3 =
-    CreateObject<PacketCounterCalculator>();
-  appTx3->SetKey ("sender-tx-packets");
-  appTx3->SetContext ("node[3]");
-  Config::Connect ("/NodeList/3/ApplicationList/*/$Sender/Tx",
-                   MakeCallback (&PacketCounterCalculator::PacketUpdate,
-                                 appTx3));
-  data.AddDataCalculator (appTx3);
-
-  //4-94
- Ptr<PacketCounterCalculator> appTx4 =
-    CreateObject<PacketCounterCalculator>();
-  appTx4->SetKey ("sender-tx-packets");
-  appTx4->SetContext ("node[4]");
-  Config::Connect ("/NodeList/4/ApplicationList/*/$Sender/Tx",
-                   MakeCallback (&PacketCounterCalculator::PacketUpdate,
-                                 appTx4));
-  data.AddDataCalculator (appTx4);
-
-  //5-95
- Ptr<PacketCounterCalculator> appTx5 =
-    CreateObject<PacketCounterCalculator>();
-  appTx5->SetKey ("sender-tx-packets");
-  appTx5->SetContext ("node[5]");
-  Config::Connect ("/NodeList/5/ApplicationList/*/$Sender/Tx",
-                   MakeCallback (&PacketCounterCalculator::PacketUpdate,
-                                 appTx5));
-  data.AddDataCalculator (appTx5);
-
-  //6-96
- Ptr<PacketCounterCalculator> appTx6 =
-    CreateObject<PacketCounterCalculator>();
-  appTx6->SetKey ("sender-tx-packets");
-  appTx6->SetContext ("node[6]");
-  Config::Connect ("/NodeList/6/ApplicationList/*/$Sender/Tx",
-                   MakeCallback (&PacketCounterCalculator::PacketUpdate,
-                                 appTx6));
-  data.AddDataCalculator (appTx6);
-
-  //7-97
- Ptr<PacketCounterCalculator> appTx7 =
-    CreateObject<PacketCounterCalculator>();
-  appTx7->SetKey ("sender-tx-packets");
-  appTx7->SetContext ("node[7]");
-  Config::Connect ("/NodeList/7/ApplicationList/*/$Sender/Tx",
-                   MakeCallback (&PacketCounterCalculator::PacketUpdate,
-                                 appTx7));
-  data.AddDataCalculator (appTx7);
-
-  //8-98
- Ptr<PacketCounterCalculator> appTx8 =
-    CreateObject<PacketCounterCalculator>();
-  appTx8->SetKey ("sender-tx-packets");
-  appTx8->SetContext ("node[8]");
-  Config::Connect ("/NodeList/8/ApplicationList/*/$Sender/Tx",
-                   MakeCallback (&PacketCounterCalculator::PacketUpdate,
-                                 appTx8));
-  data.AddDataCalculator (appTx8);
-
-  //9-99
- Ptr<PacketCounterCalculator> appTx9 =
-    CreateObject<PacketCounterCalculator>();
-  appTx9->SetKey ("sender-tx-packets");
-  appTx9->SetContext ("node[9]");
-  Config::Connect ("/NodeList/9/ApplicationList/*/$Sender/Tx",
-                   MakeCallback (&PacketCounterCalculator::PacketUpdate,
-                                 appTx9));
-  data.AddDataCalculator (appTx9);
-
-
-  // Here a counter for received packets is directly manipulated by
-  // one of the custom objects in our simulation, the Receiver
-  // Application.  The Receiver object is given a pointer to the
-  // counter and calls its Update() method whenever a packet arrives.
-  Ptr<CounterCalculator<> > appRx0 =
-    CreateObject<CounterCalculator<> >();
-  appRx0->SetKey ("receiver-rx-packets");
-  appRx0->SetContext ("node[90]");
-  receiver0->SetCounter (appRx0);//Receiver::SetCounter
-  data.AddDataCalculator (appRx0);
-
-
-  Ptr<CounterCalculator<> > appRx =
-    CreateObject<CounterCalculator<> >();
-  appRx->SetKey ("receiver-rx-packets");
-  appRx->SetContext ("node[91]");
-  receiver->SetCounter (appRx);//Receiver::SetCounter
-  data.AddDataCalculator (appRx);
-
-
-
-  //2-92
-   Ptr<CounterCalculator<> > appRx2 =
-    CreateObject<CounterCalculator<> >();
-  appRx2->SetKey ("receiver-rx-packets");
-  appRx2->SetContext ("node[92]");
-  receiver2->SetCounter (appRx2);//Receiver::SetCounter
-  data.AddDataCalculator (appRx2);
-
-
-  //3-93
- Ptr<CounterCalculator<> > appRx3 =
-    CreateObject<CounterCalculator<> >();
-  appRx3->SetKey ("receiver-rx-packets");
-  appRx3->SetContext ("node[93]");
-  receiver3->SetCounter (appRx3);//Receiver::SetCounter
-  data.AddDataCalculator (appRx3);
-
-  //4-94
- Ptr<CounterCalculator<> > appRx4 =
-    CreateObject<CounterCalculator<> >();
-  appRx4->SetKey ("receiver-rx-packets");
-  appRx4->SetContext ("node[94]");
-  receiver4->SetCounter (appRx4);//Receiver::SetCounter
-  data.AddDataCalculator (appRx4);
-
-  //5-95
- Ptr<CounterCalculator<> > appRx5 =
-    CreateObject<CounterCalculator<> >();
-  appRx5->SetKey ("receiver-rx-packets");
-  appRx5->SetContext ("node[95]");
-  receiver5->SetCounter (appRx5);//Receiver::SetCounter
-  data.AddDataCalculator (appRx5);
-
-  //6-96
- Ptr<CounterCalculator<> > appRx6 =
-    CreateObject<CounterCalculator<> >();
-  appRx6->SetKey ("receiver-rx-packets");
-  appRx6->SetContext ("node[96]");
-  receiver6->SetCounter (appRx6);//Receiver::SetCounter
-  data.AddDataCalculator (appRx6);
-
-  //7-97
- Ptr<CounterCalculator<> > appRx7 =
-    CreateObject<CounterCalculator<> >();
-  appRx7->SetKey ("receiver-rx-packets");
-  appRx7->SetContext ("node[97]");
-  receiver7->SetCounter (appRx7);//Receiver::SetCounter
-  data.AddDataCalculator (appRx7);
-
-  //8-98
- Ptr<CounterCalculator<> > appRx8 =
-    CreateObject<CounterCalculator<> >();
-  appRx8->SetKey ("receiver-rx-packets");
-  appRx8->SetContext ("node[98]");
-  receiver8->SetCounter (appRx8);//Receiver::SetCounter
-  data.AddDataCalculator (appRx8);
-
-  //9-99
- Ptr<CounterCalculator<> > appRx9 =
-    CreateObject<CounterCalculator<> >();
-  appRx9->SetKey ("receiver-rx-packets");
-  appRx9->SetContext ("node[99]");
-  receiver9->SetCounter (appRx9);//Receiver::SetCounter
-  data.AddDataCalculator (appRx9);
-
-
-   // This DataCalculator connects directly to the transmit trace
-  // provided by our Sender Application.  It records some basic
-  // statistics about the sizes of the packets received (min, max,
-  // avg, total # bytes), although in this scenaro they're fixed.
-  Ptr<PacketSizeMinMaxAvgTotalCalculator> appTxPkts0 =
-    CreateObject<PacketSizeMinMaxAvgTotalCalculator>();
-  appTxPkts0->SetKey ("tx-pkt-size");
-  appTxPkts0->SetContext ("node[0]");
-  Config::Connect ("/NodeList/0/ApplicationList/*/$Sender/Tx",
-                   MakeCallback
-                     (&PacketSizeMinMaxAvgTotalCalculator::PacketUpdate,
-                     appTxPkts0));
-  data.AddDataCalculator (appTxPkts0);
-
-   Ptr<PacketSizeMinMaxAvgTotalCalculator> appTxPkts =
-    CreateObject<PacketSizeMinMaxAvgTotalCalculator>();
-  appTxPkts->SetKey ("tx-pkt-size");
-  appTxPkts->SetContext ("node[1]");
-  Config::Connect ("/NodeList/1/ApplicationList/*/$Sender/Tx",
-                   MakeCallback
-                     (&PacketSizeMinMaxAvgTotalCalculator::PacketUpdate,
-                     appTxPkts));
-  data.AddDataCalculator (appTxPkts);
-
-
-
-  //2-92
-Ptr<PacketSizeMinMaxAvgTotalCalculator> appTxPkts2 =
-    CreateObject<PacketSizeMinMaxAvgTotalCalculator>();
-  appTxPkts2->SetKey ("tx-pkt-size");
-  appTxPkts2->SetContext ("node[2]");
-  Config::Connect ("/NodeList/2/ApplicationList/*/$Sender/Tx",
-                   MakeCallback
-                     (&PacketSizeMinMaxAvgTotalCalculator::PacketUpdate,
-                     appTxPkts2));
-  data.AddDataCalculator (appTxPkts2);
-
-  //3-93
-Ptr<PacketSizeMinMaxAvgTotalCalculator> appTxPkts3 =
-    CreateObject<PacketSizeMinMaxAvgTotalCalculator>();
-  appTxPkts3->SetKey ("tx-pkt-size");
-  appTxPkts3->SetContext ("node[3]");
-  Config::Connect ("/NodeList/3/ApplicationList/*/$Sender/Tx",
-                   MakeCallback
-                     (&PacketSizeMinMaxAvgTotalCalculator::PacketUpdate,
-                     appTxPkts3));
-  data.AddDataCalculator (appTxPkts3);
-
-  //4-94
-Ptr<PacketSizeMinMaxAvgTotalCalculator> appTxPkts4 =
-    CreateObject<PacketSizeMinMaxAvgTotalCalculator>();
-  appTxPkts4->SetKey ("tx-pkt-size");
-  appTxPkts4->SetContext ("node[4]");
-  Config::Connect ("/NodeList/4/ApplicationList/*/$Sender/Tx",
-                   MakeCallback
-                     (&PacketSizeMinMaxAvgTotalCalculator::PacketUpdate,
-                     appTxPkts4));
-  data.AddDataCalculator (appTxPkts4);
-
-  //5-95
-Ptr<PacketSizeMinMaxAvgTotalCalculator> appTxPkts5 =
-    CreateObject<PacketSizeMinMaxAvgTotalCalculator>();
-  appTxPkts5->SetKey ("tx-pkt-size");
-  appTxPkts5->SetContext ("node[5]");
-  Config::Connect ("/NodeList/5/ApplicationList/*/$Sender/Tx",
-                   MakeCallback
-                     (&PacketSizeMinMaxAvgTotalCalculator::PacketUpdate,
-                     appTxPkts5));
-  data.AddDataCalculator (appTxPkts5);
-
-  //6-96
-Ptr<PacketSizeMinMaxAvgTotalCalculator> appTxPkts6 =
-    CreateObject<PacketSizeMinMaxAvgTotalCalculator>();
-  appTxPkts6->SetKey ("tx-pkt-size");
-  appTxPkts6->SetContext ("node[6]");
-  Config::Connect ("/NodeList/6/ApplicationList/*/$Sender/Tx",
-                   MakeCallback
-                     (&PacketSizeMinMaxAvgTotalCalculator::PacketUpdate,
-                     appTxPkts6));
-  data.AddDataCalculator (appTxPkts6);
-
-  //7-97
-Ptr<PacketSizeMinMaxAvgTotalCalculator> appTxPkts7 =
-    CreateObject<PacketSizeMinMaxAvgTotalCalculator>();
-  appTxPkts7->SetKey ("tx-pkt-size");
-  appTxPkts7->SetContext ("node[7]");
-  Config::Connect ("/NodeList/7/ApplicationList/*/$Sender/Tx",
-                   MakeCallback
-                     (&PacketSizeMinMaxAvgTotalCalculator::PacketUpdate,
-                     appTxPkts7));
-  data.AddDataCalculator (appTxPkts7);
-
-  //8-98
-Ptr<PacketSizeMinMaxAvgTotalCalculator> appTxPkts8 =
-    CreateObject<PacketSizeMinMaxAvgTotalCalculator>();
-  appTxPkts8->SetKey ("tx-pkt-size");
-  appTxPkts8->SetContext ("node[8]");
-  Config::Connect ("/NodeList/8/ApplicationList/*/$Sender/Tx",
-                   MakeCallback
-                     (&PacketSizeMinMaxAvgTotalCalculator::PacketUpdate,
-                     appTxPkts8));
-  data.AddDataCalculator (appTxPkts8);
-
-  //9-99
-Ptr<PacketSizeMinMaxAvgTotalCalculator> appTxPkts9 =
-    CreateObject<PacketSizeMinMaxAvgTotalCalculator>();
-  appTxPkts9->SetKey ("tx-pkt-size");
-  appTxPkts9->SetContext ("node[9]");
-  Config::Connect ("/NodeList/9/ApplicationList/*/$Sender/Tx",
-                   MakeCallback
-                     (&PacketSizeMinMaxAvgTotalCalculator::PacketUpdate,
-                     appTxPkts9));
-  data.AddDataCalculator (appTxPkts9);
-
- // Here we directly manipulate another DataCollector tracking min,
-  // max, total, and average propagation delays.  Check out the Sender
-  // and Receiver classes to see how packets are tagged with
-  // timestamps to do this.
-  Ptr<TimeMinMaxAvgTotalCalculator> delayStat0 =
-    CreateObject<TimeMinMaxAvgTotalCalculator>();
-  delayStat0->SetKey ("delay0");
-  delayStat0->SetContext (".");
-  receiver0->SetDelayTracker (delayStat0);//Receiver::SetDelayTracker
-  data.AddDataCalculator (delayStat0);
-
-  Ptr<TimeMinMaxAvgTotalCalculator> delayStat =
-    CreateObject<TimeMinMaxAvgTotalCalculator>();
-  delayStat->SetKey ("delay1");
-  delayStat->SetContext (".");
-  receiver->SetDelayTracker (delayStat);//Receiver::SetDelayTracker
-  data.AddDataCalculator (delayStat);
-
-  //2
-Ptr<TimeMinMaxAvgTotalCalculator> delayStat2 =
-    CreateObject<TimeMinMaxAvgTotalCalculator>();
-  delayStat2->SetKey ("delay2");
-  delayStat2->SetContext (".");
-  receiver2->SetDelayTracker (delayStat2);//Receiver::SetDelayTracker
-  data.AddDataCalculator (delayStat2);
-  //3
-Ptr<TimeMinMaxAvgTotalCalculator> delayStat3 =
-    CreateObject<TimeMinMaxAvgTotalCalculator>();
-  delayStat3->SetKey ("delay3");
-  delayStat3->SetContext (".");
-  receiver3->SetDelayTracker (delayStat3);//Receiver::SetDelayTracker
-  data.AddDataCalculator (delayStat3);
-  //4
-Ptr<TimeMinMaxAvgTotalCalculator> delayStat4 =
-    CreateObject<TimeMinMaxAvgTotalCalculator>();
-  delayStat4->SetKey ("delay4");
-  delayStat4->SetContext (".");
-  receiver4->SetDelayTracker (delayStat4);//Receiver::SetDelayTracker
-  data.AddDataCalculator (delayStat4);
-  //5
-Ptr<TimeMinMaxAvgTotalCalculator> delayStat5 =
-    CreateObject<TimeMinMaxAvgTotalCalculator>();
-  delayStat5->SetKey ("delay5");
-  delayStat5->SetContext (".");
-  receiver5->SetDelayTracker (delayStat5);//Receiver::SetDelayTracker
-  data.AddDataCalculator (delayStat5);
-  //6
-Ptr<TimeMinMaxAvgTotalCalculator> delayStat6 =
-    CreateObject<TimeMinMaxAvgTotalCalculator>();
-  delayStat6->SetKey ("delay6");
-  delayStat6->SetContext (".");
-  receiver6->SetDelayTracker (delayStat6);//Receiver::SetDelayTracker
-  data.AddDataCalculator (delayStat6);
-  //7
-Ptr<TimeMinMaxAvgTotalCalculator> delayStat7 =
-    CreateObject<TimeMinMaxAvgTotalCalculator>();
-  delayStat7->SetKey ("delay7");
-  delayStat7->SetContext (".");
-  receiver7->SetDelayTracker (delayStat7);//Receiver::SetDelayTracker
-  data.AddDataCalculator (delayStat7);
-  //8
-Ptr<TimeMinMaxAvgTotalCalculator> delayStat8 =
-    CreateObject<TimeMinMaxAvgTotalCalculator>();
-  delayStat8->SetKey ("delay8");
-  delayStat8->SetContext (".");
-  receiver8->SetDelayTracker (delayStat8);//Receiver::SetDelayTracker
-  data.AddDataCalculator (delayStat8);
-  //9
- Ptr<TimeMinMaxAvgTotalCalculator> delayStat9 =
-    CreateObject<TimeMinMaxAvgTotalCalculator>();
-  delayStat9->SetKey ("delay9");
-  delayStat9->SetContext (".");
-  receiver9->SetDelayTracker (delayStat9);//Receiver::SetDelayTracker
-  data.AddDataCalculator (delayStat9);
-
-
+  // Radio energy of every node by PHY state and by role: frames it
+  // originated, forwarded or received as the flow's sink.
+  if (energyBreakdown)
+    {
+      Ptr<RadioEnergyBreakdown> radioEnergy =
+        CreateObject<RadioEnergyBreakdown>();//能耗分解
+      radioEnergy->SetKey ("radio-energy");
+      radioEnergy->SetDataPorts (FlowTable::BASE_PORT, FlowTable::BASE_PORT + flows.GetN () - 1);
+      radioEnergy->Install (radioStates);
+      data.AddDataCalculator (radioEnergy);
+    }
 
+  // Data rate chosen on every link that carried unicast data; with the
+  // constant rate manager every link uses phyMode.
+  if (rateManager != "constant")
+    {
+      Ptr<LinkRateCalculator> linkRate =
+        CreateObject<LinkRateCalculator>();//各链路速率
+      linkRate->SetKey ("link-rate-mbps");
+      linkRate->Install (devices);
+      data.AddDataCalculator (linkRate);
+    }
 
+  // Application counters, packet sizes and delays of every flow.
+  flows.InstallStatistics (data);
 
-  AnimationInterface anim("ly4-3289.xml");
-  anim.SetMaxPktsPerTraceFile(99999999999999);
+  AnimationInterface *animation = 0;
+  AnimRecordWriter animStream;
+  if (anim && animFormat == "bin")
+    {
+      // compact record stream; ly2017210600AnimConvert turns it into XML
+      animStream.SetRotation (Seconds (animWindow), animSegmentMb * 1024ULL * 1024ULL);
+      animStream.Open (animFile);
+      animStream.SetFlushInterval (Seconds (animFlush));
+      if (!animNodes.empty ())
+        {
+          animStream.SetNodeFilter (animNodes, numNodes);
+        }
+      stringstream flowList (animFlows);
+      string flow;
+      while (getline (flowList, flow, ','))
+        {
+          uint32_t index = atoi (flow.c_str ());
+          NS_ABORT_MSG_IF (index >= flows.GetN (), "No flow " << index);
+          const FlowSpec &spec = flows.Get (index);
+          animStream.AddFlowFilter (i.GetAddress (spec.src), i.GetAddress (spec.dst));
+        }
+      animStream.Install (c);
+    }
+  else if (anim)
+    {
+      animation = new AnimationInterface (animFile + ".xml");
+      animation->SetMaxPktsPerTraceFile (animMaxPkts);
+    }
   Simulator::Stop (Seconds (33.0));
   Simulator::Run ();
+  NS_LOG_UNCOND ("simulated events: " << Simulator::GetEventCount ());
+  if (profile)
+    {
+      ProfilingScheduler::WriteFolded (prefix == "data" ? "profile.folded" : prefix + "-profile.folded");
+      ProfilingScheduler::PrintTop (cout, 20);
+    }
+  animStream.Close ();
+  energySampler.Close ();
+  if (dutyCycle < 1)
+    {
+      NS_LOG_UNCOND ("duty cycle: " << dutySchedule.GetCycles () << " wake-ups, "
+                     << (gridChannel != 0 ? gridChannel->GetAsleep () : 0)
+                     << " receptions skipped at sleeping radios");
+    }
+  if (pool != 0)
+    {
+      NS_LOG_UNCOND ("packet pool: " << pool->GetHits () << " reused, " << pool->GetMisses ()
+                     << " allocated, hit rate " << pool->GetHitRate ());
+    }
 
     //------------------------------------------------------------
   //-- Generate statistics output.
@@ -1114,6 +867,9 @@ Ptr<TimeMinMaxAvgTotalCalculator> delayStat8 =
   if (format == "omnet") {
       NS_LOG_INFO ("Creating omnet formatted data output.");
       output = CreateObject<OmnetDataOutput>();
+    } else if (format == "columnar") {
+      NS_LOG_INFO ("Creating columnar formatted data output.");
+      output = CreateObject<ColumnarDataOutput>();
     } else if (format == "db") {
     #ifdef STATS_HAS_SQLITE3
       NS_LOG_INFO ("Creating sqlite formatted data output.");
@@ -1126,13 +882,18 @@ Ptr<TimeMinMaxAvgTotalCalculator> delayStat8 =
   // Finally, have that writer interrogate the DataCollector and save
   // the results.
   if (output != 0)
-    output->Output (data);
+    {
+      output->SetFilePrefix (prefix);
+      output->Output (data);
+    }
 
-  ofstream fout("energy.txt");
+  ofstream fout(prefix == "data" ? "energy.txt" : (prefix + "-energy.txt").c_str ());
 //迭代器计算能耗数值
-  for (DeviceEnergyModelContainer::Iterator iter = deviceModels.Begin (); iter != deviceModels.End (); iter ++)
+  for (uint32_t k = 0; k < radios; ++k)
     {
-      double energyConsumed = (*iter)->GetTotalEnergyConsumption ();
+      double energyConsumed = (lazyEnergy != 0 ? lazyEnergy->GetTotalEnergyConsumption (k)
+                                                : deviceModels.Get (k)->GetTotalEnergyConsumption ())
+        - warmupConsumed[k];
       NS_LOG_UNCOND ("End of simulation (" << Simulator::Now ().GetSeconds ()
                      << "s) Total energy consumed by radio = " << energyConsumed << "J");
      fout<<energyConsumed<<endl;
@@ -1141,7 +902,11 @@ Ptr<TimeMinMaxAvgTotalCalculator> delayStat8 =
   fout.close();
 
 
-
+  delete animation;
+  if (radioStates != 0)
+    {
+      radioStates->Dispose ();
+    }
   Simulator::Destroy ();
 
   return 0;
@@ -0,0 +1,304 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Converts the compact animation stream written by
+// "ly2017210600 --animFormat=bin" (see anim-record-format.h) into
+// NetAnim XML:
+//
+// ./waf --run "ly2017210600AnimConvert --in=ly4-3289.lyan --out=ly4-3289.xml"
+//
+// Given the index of a segmented stream, only the blocks overlapping
+// the requested window of simulated time are read:
+//
+// ./waf --run "ly2017210600AnimConvert --in=ly4-3289.lyidx --from=29 --to=31 --out=olsr-29-31.xml"
+//
+// Sent frames become <pr> records, received frames <wpr> records and
+// position changes <nu p="p"> records.  Drops have no NetAnim
+// counterpart and are only counted.
+//
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ns3/command-line.h"
+#include "anim-record-format.h"
+
+using namespace ns3;
+using namespace std;
+
+struct MappedFile
+{
+  MappedFile () : fd (-1), data (0), size (0) {}
+  ~MappedFile ()
+  {
+    if (data != 0)
+      {
+        munmap (const_cast<uint8_t *> (data), size);
+      }
+    if (fd >= 0)
+      {
+        close (fd);
+      }
+  }
+
+  bool Open (string name)
+  {
+    struct stat st;
+    fd = open (name.c_str (), O_RDONLY);
+    if (fd < 0 || fstat (fd, &st) != 0)
+      {
+        cerr << "Cannot open " << name << ": " << strerror (errno) << endl;
+        return false;
+      }
+    size = st.st_size;
+    if (size < anim::MAGIC_SIZE)
+      {
+        cerr << name << " is not an animation stream" << endl;
+        return false;
+      }
+    void *map = mmap (0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+      {
+        cerr << "Cannot map " << name << ": " << strerror (errno) << endl;
+        return false;
+      }
+    data = static_cast<const uint8_t *> (map);
+    if (memcmp (data, anim::MAGIC, anim::MAGIC_SIZE) != 0)
+      {
+        cerr << name << " is not an animation stream" << endl;
+        return false;
+      }
+    return true;
+  }
+
+  int fd;
+  const uint8_t *data;
+  size_t size;
+};
+
+struct Converter
+{
+  Converter (ostream &xml, uint64_t from, uint64_t to)
+    : xml (xml), from (from), to (to), records (0), drops (0), truncated (false)
+  {
+  }
+
+  /// Write the records of [begin, end) that fall into [from, to].
+  void Convert (const uint8_t *begin, const uint8_t *end)
+  {
+    anim::Decoder decoder (begin, end);
+    anim::Record r;
+    while (decoder.Next (r))
+      {
+        if (r.type == anim::NODE)
+          {
+            // Every segment repeats the node table; keep the first.
+            if (nodes.insert (r.node).second)
+              {
+                xml << "<node id=\"" << r.node << "\" sysId=\"0\" locX=\"" << r.x
+                    << "\" locY=\"" << r.y << "\" />" << "\n";
+              }
+            continue;
+          }
+        if (r.type == anim::SYNC || r.timeNs < from || r.timeNs > to)
+          {
+            continue;
+          }
+        ++records;
+        double t = r.timeNs * 1e-9;
+        switch (r.type)
+          {
+          case anim::POS:
+            xml << "<nu p=\"p\" t=\"" << t << "\" id=\"" << r.node << "\" x=\"" << r.x
+                << "\" y=\"" << r.y << "\" />" << "\n";
+            break;
+          case anim::TX:
+            xml << "<pr uId=\"" << r.uid << "\" fId=\"" << r.node << "\" fbTx=\"" << t
+                << "\" />" << "\n";
+            break;
+          case anim::RX:
+            xml << "<wpr uId=\"" << r.uid << "\" tId=\"" << r.node << "\" fbRx=\"" << t
+                << "\" lbRx=\"0\" />" << "\n";
+            break;
+          case anim::DROP:
+            ++drops;
+            break;
+          default:
+            break;
+          }
+      }
+    truncated = truncated || decoder.Position () != end;
+  }
+
+  ostream &xml;
+  uint64_t from;
+  uint64_t to;
+  set<uint32_t> nodes;
+  uint64_t records;
+  uint64_t drops;
+  bool truncated;
+};
+
+/**
+ * Convert the blocks of a segmented stream that overlap [from, to],
+ * plus the node table block at the start of each segment read.
+ */
+static bool
+ConvertIndex (string indexName, Converter &converter)
+{
+  ifstream index (indexName.c_str ());
+  if (!index)
+    {
+      cerr << "Cannot open " << indexName << endl;
+      return false;
+    }
+  string dir;
+  string::size_type slash = indexName.rfind ('/');
+  if (slash != string::npos)
+    {
+      dir = indexName.substr (0, slash + 1);
+    }
+
+  vector<string> segments;
+  string line;
+  MappedFile *file = 0;
+  uint32_t mapped = numeric_limits<uint32_t>::max ();
+  while (getline (index, line))
+    {
+      istringstream fields (line);
+      string kind;
+      fields >> kind;
+      if (kind == "segment")
+        {
+          uint32_t n;
+          string name;
+          fields >> n >> name;
+          if (segments.size () <= n)
+            {
+              segments.resize (n + 1);
+            }
+          // Segment names are relative to where the scenario ran.
+          segments[n] = name.find ('/') == string::npos ? dir + name : name;
+        }
+      else if (kind == "block")
+        {
+          uint32_t segment;
+          uint64_t offset, bytes, first, last;
+          if (!(fields >> segment >> offset >> bytes >> first >> last))
+            {
+              continue;
+            }
+          bool header = offset == anim::MAGIC_SIZE;
+          if (!header && (last < converter.from || first > converter.to))
+            {
+              continue;
+            }
+          if (header && first > converter.to)
+            {
+              break;
+            }
+          if (segment != mapped)
+            {
+              delete file;
+              file = new MappedFile;
+              mapped = segment;
+              if (segment >= segments.size () || !file->Open (segments[segment]))
+                {
+                  delete file;
+                  return false;
+                }
+            }
+          if (offset + bytes > file->size)
+            {
+              converter.truncated = true;
+              continue;
+            }
+          converter.Convert (file->data + offset, file->data + offset + bytes);
+        }
+    }
+  delete file;
+  return true;
+}
+
+int main (int argc, char *argv[])
+{
+  string in;
+  string out;
+  double from = 0;
+  double to = -1;
+
+  CommandLine cmd;
+  cmd.AddValue ("in", "Animation stream (.lyan) or index of a segmented stream (.lyidx)", in);
+  cmd.AddValue ("out", "NetAnim XML file to write", out);
+  cmd.AddValue ("from", "First second of simulated time to convert", from);
+  cmd.AddValue ("to", "Last second of simulated time to convert (negative: end)", to);
+  cmd.Parse (argc, argv);
+
+  if (in.empty () || out.empty ())
+    {
+      cerr << "Usage: ly2017210600AnimConvert --in=<file.lyan|file.lyidx> --out=<file.xml>"
+           << " [--from=<s>] [--to=<s>]" << endl;
+      return 1;
+    }
+
+  ofstream xml (out.c_str ());
+  xml << setprecision (10);
+  xml << "<anim ver=\"netanim-3.108\" filetype=\"animation\" >" << "\n";
+  Converter converter (xml, static_cast<uint64_t> (from * 1e9),
+                       to < 0 ? numeric_limits<uint64_t>::max () : static_cast<uint64_t> (to * 1e9));
+
+  bool ok;
+  if (in.size () > 6 && in.compare (in.size () - 6, 6, ".lyidx") == 0)
+    {
+      ok = ConvertIndex (in, converter);
+    }
+  else
+    {
+      MappedFile file;
+      ok = file.Open (in);
+      if (ok)
+        {
+          madvise (const_cast<uint8_t *> (file.data), file.size, MADV_SEQUENTIAL);
+          converter.Convert (file.data + anim::MAGIC_SIZE, file.data + file.size);
+        }
+    }
+  xml << "</anim>" << "\n";
+  if (!ok)
+    {
+      return 1;
+    }
+
+  if (converter.truncated)
+    {
+      cerr << "Warning: stream truncated" << endl;
+    }
+  cout << converter.records << " records, " << converter.drops << " drops" << endl;
+  return 0;
+}
@@ -0,0 +1,448 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Benchmark of the adhoc grid scenarios.
+//
+// Runs a fixed matrix of scenario invocations, one at a time and with
+// fixed seeds, each in its own directory under --work, and records per
+// case the wall time, simulated events per second, peak resident set
+// size and the bytes of output the case wrote:
+//
+// ./waf --run "ly2017210600Benchmark --bin=build/scratch --update-baseline"
+// ./waf --run "ly2017210600Benchmark --bin=build/scratch"
+//
+// The default matrix is the static grid (ly2017210600) and the random
+// walk (ly2017210600RandomWalk2d), each with OLSR and AODV and with 25,
+// 100, 400 and 1000 nodes, with tracing (pcap, ascii and
+// NetAnim) off and on.  --matrix reads a file instead, one case per
+// line: "name binary arguments...".  --filter keeps the cases whose
+// name contains the text.
+//
+// Results go to --out.  With --update-baseline they become the new
+// baseline; otherwise every case of the baseline is compared and the
+// program exits with 1 if wall time or peak RSS grew by more than
+// --threshold (a fraction).  With --repeat=N the fastest of N runs
+// counts.
+//
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "ns3/command-line.h"
+
+using namespace ns3;
+using namespace std;
+
+struct BenchCase
+{
+  string name;
+  string binary;
+  vector<string> args;
+};
+
+struct BenchResult
+{
+  double wall;          //!< seconds
+  uint64_t events;
+  uint64_t rssKb;       //!< peak resident set size
+  uint64_t outputBytes;
+};
+
+static vector<BenchCase>
+DefaultMatrix (void)
+{
+  static const uint32_t nodes[] = { 25, 100, 400, 1000 };
+  vector<BenchCase> cases;
+  for (uint32_t walk = 0; walk < 2; ++walk)
+    {
+      for (uint32_t p = 0; p < 2; ++p)
+        {
+          string protocol = p == 0 ? "olsr" : "aodv";
+          for (uint32_t n = 0; n < 4; ++n)
+            {
+              for (uint32_t tracing = 0; tracing < 2; ++tracing)
+                {
+                  BenchCase c;
+                  ostringstream name;
+                  name << (walk ? "walk" : "static") << "-" << protocol << "-" << nodes[n]
+                       << (tracing ? "-trace" : "");
+                  c.name = name.str ();
+                  c.binary = walk ? "ly2017210600RandomWalk2d" : "ly2017210600";
+                  ostringstream numNodes;
+                  numNodes << "--numNodes=" << nodes[n];
+                  c.args.push_back (numNodes.str ());
+                  c.args.push_back (tracing ? "--tracing=1" : "--tracing=0");
+                  c.args.push_back ("--strategy=" + protocol);
+                  if (!walk)
+                    {
+                      c.args.push_back (tracing ? "--anim=1" : "--anim=0");
+                    }
+                  c.args.push_back ("--RngSeed=1");
+                  c.args.push_back ("--RngRun=1");
+                  cases.push_back (c);
+                }
+            }
+        }
+    }
+  return cases;
+}
+
+static vector<BenchCase>
+LoadMatrix (const string &fileName)
+{
+  vector<BenchCase> cases;
+  ifstream in (fileName.c_str ());
+  if (!in)
+    {
+      cerr << "Cannot open " << fileName << endl;
+      exit (1);
+    }
+  string line;
+  while (getline (in, line))
+    {
+      string::size_type hash = line.find ('#');
+      if (hash != string::npos)
+        {
+          line.erase (hash);
+        }
+      istringstream fields (line);
+      BenchCase c;
+      if (!(fields >> c.name >> c.binary))
+        {
+          continue;
+        }
+      string arg;
+      while (fields >> arg)
+        {
+          c.args.push_back (arg);
+        }
+      cases.push_back (c);
+    }
+  return cases;
+}
+
+/// \return bytes of the files below dir, except the case's own log
+static uint64_t
+DirectoryBytes (const string &dir)
+{
+  uint64_t bytes = 0;
+  DIR *d = opendir (dir.c_str ());
+  if (d == 0)
+    {
+      return 0;
+    }
+  struct dirent *entry;
+  while ((entry = readdir (d)) != 0)
+    {
+      string name = entry->d_name;
+      if (name == "." || name == ".." || name == "bench.log")
+        {
+          continue;
+        }
+      string path = dir + "/" + name;
+      struct stat st;
+      if (stat (path.c_str (), &st) != 0)
+        {
+          continue;
+        }
+      bytes += S_ISDIR (st.st_mode) ? DirectoryBytes (path) : st.st_size;
+    }
+  closedir (d);
+  return bytes;
+}
+
+static void
+ClearDirectory (const string &dir)
+{
+  DIR *d = opendir (dir.c_str ());
+  if (d == 0)
+    {
+      return;
+    }
+  struct dirent *entry;
+  while ((entry = readdir (d)) != 0)
+    {
+      string name = entry->d_name;
+      if (name == "." || name == "..")
+        {
+          continue;
+        }
+      string path = dir + "/" + name;
+      struct stat st;
+      if (stat (path.c_str (), &st) == 0 && S_ISDIR (st.st_mode))
+        {
+          ClearDirectory (path);
+          rmdir (path.c_str ());
+        }
+      else
+        {
+          unlink (path.c_str ());
+        }
+    }
+  closedir (d);
+}
+
+/// \return the count printed by the scenario as "simulated events: N"
+static uint64_t
+ReadEvents (const string &logName)
+{
+  ifstream log (logName.c_str ());
+  string line;
+  uint64_t events = 0;
+  while (getline (log, line))
+    {
+      string::size_type pos = line.find ("simulated events: ");
+      if (pos != string::npos)
+        {
+          events = strtoull (line.c_str () + pos + 18, 0, 10);
+        }
+    }
+  return events;
+}
+
+static bool
+RunCase (const BenchCase &c, const string &binary, const string &dir, BenchResult &result)
+{
+  mkdir (dir.c_str (), 0755);
+  ClearDirectory (dir);
+  string logName = dir + "/bench.log";
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+  pid_t pid = fork ();
+  if (pid < 0)
+    {
+      cerr << "fork failed: " << strerror (errno) << endl;
+      return false;
+    }
+  if (pid == 0)
+    {
+      if (chdir (dir.c_str ()) != 0)
+        {
+          _exit (126);
+        }
+      int log = open ("bench.log", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (log >= 0)
+        {
+          dup2 (log, STDOUT_FILENO);
+          dup2 (log, STDERR_FILENO);
+          close (log);
+        }
+      vector<char *> argv;
+      argv.push_back (const_cast<char *> (binary.c_str ()));
+      for (uint32_t i = 0; i < c.args.size (); ++i)
+        {
+          argv.push_back (const_cast<char *> (c.args[i].c_str ()));
+        }
+      argv.push_back (0);
+      execv (binary.c_str (), &argv[0]);
+      _exit (127);
+    }
+
+  int status;
+  struct rusage usage;
+  while (wait4 (pid, &status, 0, &usage) < 0)
+    {
+      if (errno != EINTR)
+        {
+          cerr << "wait4 failed: " << strerror (errno) << endl;
+          return false;
+        }
+    }
+  result.wall = chrono::duration<double> (chrono::steady_clock::now () - start).count ();
+  if (!WIFEXITED (status) || WEXITSTATUS (status) != 0)
+    {
+      cerr << c.name << " failed, see " << logName << endl;
+      return false;
+    }
+  result.rssKb = usage.ru_maxrss;
+  result.events = ReadEvents (logName);
+  result.outputBytes = DirectoryBytes (dir);
+  return true;
+}
+
+static map<string, BenchResult>
+LoadResults (const string &fileName)
+{
+  map<string, BenchResult> results;
+  ifstream in (fileName.c_str ());
+  string line;
+  while (getline (in, line))
+    {
+      if (line.empty () || line[0] == '#')
+        {
+          continue;
+        }
+      istringstream fields (line);
+      string name;
+      double eventsPerSecond;
+      BenchResult r;
+      if (fields >> name >> r.wall >> r.events >> eventsPerSecond >> r.rssKb >> r.outputBytes)
+        {
+          results[name] = r;
+        }
+    }
+  return results;
+}
+
+static void
+WriteResults (ostream &os, const vector<pair<string, BenchResult> > &results)
+{
+  os << "# case\twall_s\tevents\tevents_per_s\tpeak_rss_kb\toutput_bytes" << endl;
+  for (uint32_t i = 0; i < results.size (); ++i)
+    {
+      const BenchResult &r = results[i].second;
+      os << results[i].first << "\t" << fixed << setprecision (3) << r.wall << "\t" << r.events
+         << "\t" << setprecision (0) << (r.wall > 0 ? r.events / r.wall : 0)
+         << "\t" << r.rssKb << "\t" << r.outputBytes << endl;
+    }
+}
+
+int main (int argc, char *argv[])
+{
+  string bin ("build/scratch");
+  string matrix;
+  string filter;
+  string work ("bench.d");
+  string out ("bench.tsv");
+  string baseline ("bench-baseline.tsv");
+  bool updateBaseline = false;
+  double threshold = 0.10;
+  uint32_t repeat = 1;
+
+  CommandLine cmd;
+  cmd.AddValue ("bin", "Directory of the scenario binaries", bin);
+  cmd.AddValue ("matrix", "Case file, one \"name binary arguments...\" per line (default: built-in matrix)", matrix);
+  cmd.AddValue ("filter", "Run only cases whose name contains this text", filter);
+  cmd.AddValue ("work", "Directory the cases run in", work);
+  cmd.AddValue ("out", "Results table to write", out);
+  cmd.AddValue ("baseline", "Baseline results to compare with", baseline);
+  cmd.AddValue ("update-baseline", "Store the results as the new baseline", updateBaseline);
+  cmd.AddValue ("threshold", "Allowed growth of wall time and peak RSS (fraction)", threshold);
+  cmd.AddValue ("repeat", "Runs per case; the fastest counts", repeat);
+  cmd.Parse (argc, argv);
+
+  vector<BenchCase> cases = matrix.empty () ? DefaultMatrix () : LoadMatrix (matrix);
+  char cwd[4096];
+  if (getcwd (cwd, sizeof (cwd)) == 0)
+    {
+      cerr << "getcwd failed: " << strerror (errno) << endl;
+      return 1;
+    }
+  // the cases run in their own directories
+  string binDir = bin[0] == '/' ? bin : string (cwd) + "/" + bin;
+  string workDir = work[0] == '/' ? work : string (cwd) + "/" + work;
+  mkdir (workDir.c_str (), 0755);
+
+  vector<pair<string, BenchResult> > results;
+  uint32_t failed = 0;
+  for (uint32_t i = 0; i < cases.size (); ++i)
+    {
+      const BenchCase &c = cases[i];
+      if (!filter.empty () && c.name.find (filter) == string::npos)
+        {
+          continue;
+        }
+      string binary = c.binary[0] == '/' ? c.binary : binDir + "/" + c.binary;
+      BenchResult best = { 0, 0, 0, 0 };
+      bool ok = true;
+      for (uint32_t k = 0; k < max (repeat, 1u) && ok; ++k)
+        {
+          BenchResult r;
+          ok = RunCase (c, binary, workDir + "/" + c.name, r);
+          if (ok && (k == 0 || r.wall < best.wall))
+            {
+              best = r;
+            }
+        }
+      if (!ok)
+        {
+          ++failed;
+          continue;
+        }
+      cout << c.name << ": " << fixed << setprecision (2) << best.wall << " s, "
+           << setprecision (0) << (best.wall > 0 ? best.events / best.wall : 0) << " events/s, "
+           << best.rssKb / 1024 << " MB peak, " << best.outputBytes / 1024 << " KB output" << endl;
+      results.push_back (make_pair (c.name, best));
+    }
+
+  ofstream table (out.c_str ());
+  WriteResults (table, results);
+  if (updateBaseline)
+    {
+      ofstream base (baseline.c_str ());
+      WriteResults (base, results);
+      cout << "Baseline " << baseline << " updated with " << results.size () << " cases" << endl;
+      return failed == 0 ? 0 : 1;
+    }
+
+  map<string, BenchResult> reference = LoadResults (baseline);
+  if (reference.empty ())
+    {
+      cout << "No baseline in " << baseline << "; run with --update-baseline to store one" << endl;
+      return failed == 0 ? 0 : 1;
+    }
+  uint32_t regressions = 0;
+  for (uint32_t i = 0; i < results.size (); ++i)
+    {
+      map<string, BenchResult>::const_iterator it = reference.find (results[i].first);
+      if (it == reference.end ())
+        {
+          continue;
+        }
+      const BenchResult &now = results[i].second;
+      const BenchResult &then = it->second;
+      if (now.wall > then.wall * (1 + threshold))
+        {
+          ++regressions;
+          cout << "REGRESSION " << results[i].first << ": wall " << setprecision (2) << then.wall
+               << " -> " << now.wall << " s" << endl;
+        }
+      if (now.rssKb > then.rssKb * (1 + threshold))
+        {
+          ++regressions;
+          cout << "REGRESSION " << results[i].first << ": peak RSS " << then.rssKb
+               << " -> " << now.rssKb << " KB" << endl;
+        }
+      if (now.events != then.events)
+        {
+          // same seeds, so a different count means the scenario changed
+          cout << "NOTE " << results[i].first << ": events " << then.events
+               << " -> " << now.events << endl;
+        }
+    }
+  cout << regressions << " regressions against " << baseline << " (threshold "
+       << setprecision (0) << threshold * 100 << "%)" << endl;
+  return regressions == 0 && failed == 0 ? 0 : 1;
+}
@@ -68,6 +68,13 @@
 //
 // tcpdump -r wifi-simple-adhoc-grid-0-0.pcap -nn -tt
 //
+// With many walking nodes most of the run goes into the channel
+// computing loss to every PHY.  --channel=grid only visits PHYs that can
+// be in range; the walkers never exceed --speed, so the buckets stay
+// valid for a while and are refreshed as time passes:
+//
+// ./waf --run "ly2017210600RandomWalk2d --numNodes=1000 --channel=grid"
+//
 
 #include "ns3/command-line.h"
 #include "ns3/config.h"
@@ -80,11 +87,16 @@
 #include "ns3/ipv4-address-helper.h"
 #include "ns3/yans-wifi-channel.h"
 #include "ns3/mobility-model.h"
-#include "ns3/olsr-helper.h"
-#include "ns3/ipv4-static-routing-helper.h"
-#include "ns3/ipv4-list-routing-helper.h"
+#include "ns3/ipv4-routing-helper.h"
 #include "ns3/internet-stack-helper.h"
 #include "ns3/netanim-module.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/propagation-delay-model.h"
+
+#include "grid-yans-wifi-channel.h"
+#include "packet-pool.h"
+#include "routing-registry.h"
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("WifiSimpleAdhocGrid");
@@ -98,13 +110,13 @@ void ReceivePacket (Ptr<Socket> socket)
 }
 
 static void GenerateTraffic (Ptr<Socket> socket, uint32_t pktSize,
-                             uint32_t pktCount, Time pktInterval )
+                             uint32_t pktCount, Time pktInterval, Ptr<PacketPool> pool)
 {
   if (pktCount > 0)
     {
-      socket->Send (Create<Packet> (pktSize));
+      socket->Send (pool != 0 ? pool->Get (pktSize) : Create<Packet> (pktSize));
       Simulator::Schedule (pktInterval, &GenerateTraffic,
-                           socket, pktSize,pktCount - 1, pktInterval);
+                           socket, pktSize,pktCount - 1, pktInterval, pool);
     }
   else
     {
@@ -125,6 +137,10 @@ int main (int argc, char *argv[])
   double interval = 1.0; // seconds
   bool verbose = false;
   bool tracing = false;
+  double speed = 200; // m/s
+  std::string channel ("yans");//yans 或 grid
+  bool packetPool = false;
+  std::string strategy ("olsr");
 
   CommandLine cmd;
   cmd.AddValue ("phyMode", "Wifi Phy mode", phyMode);
@@ -137,6 +153,14 @@ int main (int argc, char *argv[])
   cmd.AddValue ("numNodes", "number of nodes", numNodes);
   cmd.AddValue ("sinkNode", "Receiver node number", sinkNode);
   cmd.AddValue ("sourceNode", "Sender node number", sourceNode);
+  cmd.AddValue ("speed", "walking speed (m/s)", speed);
+  cmd.AddValue ("channel", "yans, or grid to skip receivers beyond detection range", channel);
+  // the static next-hop matrix is built from the starting positions
+  // and would be stale as soon as the nodes move
+  RoutingRegistry routing;
+  routing.Remove ("static");
+  cmd.AddValue ("strategy", "routing protocol: " + routing.GetNames (), strategy);
+  cmd.AddValue ("packetPool", "recycle the generated packets (packet uids repeat)", packetPool);
   cmd.Parse (argc, argv);
   // Convert to time object
   Time interPacketInterval = Seconds (interval);
@@ -162,10 +186,21 @@ int main (int argc, char *argv[])
   // ns-3 supports RadioTap and Prism tracing extensions for 802.11b
   wifiPhy.SetPcapDataLinkType (WifiPhyHelper::DLT_IEEE802_11_RADIO);
 
-  YansWifiChannelHelper wifiChannel;
-  wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
-  wifiChannel.AddPropagationLoss ("ns3::FriisPropagationLossModel");
-  wifiPhy.SetChannel (wifiChannel.Create ());
+  Ptr<GridYansWifiChannel> gridChannel;
+  if (channel == "grid")
+    {
+      gridChannel = CreateObject<GridYansWifiChannel> ();
+      gridChannel->SetPropagationDelayModel (CreateObject<ConstantSpeedPropagationDelayModel> ());
+      gridChannel->SetPropagationLossModel (CreateObject<FriisPropagationLossModel> ());
+      gridChannel->SetMaxSpeed (speed);
+    }
+  else
+    {
+      YansWifiChannelHelper wifiChannel;
+      wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+      wifiChannel.AddPropagationLoss ("ns3::FriisPropagationLossModel");
+      wifiPhy.SetChannel (wifiChannel.Create ());
+    }
 
   // Add an upper mac and disable rate control
   WifiMacHelper wifiMac;
@@ -175,7 +210,16 @@ int main (int argc, char *argv[])
                                 "ControlMode",StringValue (phyMode));
   // Set it to adhoc mode
   wifiMac.SetType ("ns3::AdhocWifiMac");
-  NetDeviceContainer devices = wifi.Install (wifiPhy, wifiMac, c);
+  NetDeviceContainer devices;
+  if (gridChannel != 0)
+    {
+      GridYansWifiPhyHelper gridPhy (wifiPhy, gridChannel);
+      devices = wifi.Install (gridPhy, wifiMac, c);
+    }
+  else
+    {
+      devices = wifi.Install (wifiPhy, wifiMac, c);
+    }
 
   MobilityHelper mobility;
   mobility.SetPositionAllocator ("ns3::GridPositionAllocator",
@@ -187,16 +231,13 @@ int main (int argc, char *argv[])
                                  "LayoutType", StringValue ("RowFirst"));
   mobility.SetMobilityModel ("ns3::RandomWalk2dMobilityModel",
 		  "Bounds",RectangleValue(Rectangle(-50.0,4500.0,-50,4500.0)),
-		  "Speed",StringValue("ns3::UniformRandomVariable[Min=200|Max=200]"));
+		  "Speed",StringValue("ns3::UniformRandomVariable[Min=" + std::to_string (speed)
+                      + "|Max=" + std::to_string (speed) + "]"));
   mobility.Install (c);
 
-  // Enable OLSR
-  OlsrHelper olsr;
-  Ipv4StaticRoutingHelper staticRouting;
-
-  Ipv4ListRoutingHelper list;
-  list.Add (staticRouting, 0);
-  list.Add (olsr, 10);
+  // Enable the selected routing protocol, OLSR by default
+  NS_ABORT_MSG_IF (strategy == "static", "strategy=static needs nodes that do not move");
+  Ipv4ListRoutingHelper list = routing.GetListRouting (strategy);
 
   InternetStackHelper internet;
   internet.SetRoutingHelper (list); // has effect on the next Install ()
@@ -224,16 +265,17 @@ int main (int argc, char *argv[])
       wifiPhy.EnablePcap ("wifi-simple-adhoc-grid", devices);
       // Trace routing tables
       Ptr<OutputStreamWrapper> routingStream = Create<OutputStreamWrapper> ("wifi-simple-adhoc-grid.routes", std::ios::out);
-      olsr.PrintRoutingTableAllEvery (Seconds (2), routingStream);
+      Ipv4RoutingHelper::PrintRoutingTableAllEvery (Seconds (2), routingStream);
       Ptr<OutputStreamWrapper> neighborStream = Create<OutputStreamWrapper> ("wifi-simple-adhoc-grid.neighbors", std::ios::out);
-      olsr.PrintNeighborCacheAllEvery (Seconds (2), neighborStream);
+      Ipv4RoutingHelper::PrintNeighborCacheAllEvery (Seconds (2), neighborStream);
 
       // To do-- enable an IP-level trace that shows forwarding events only
     }
 
   // Give OLSR time to converge-- 30 seconds perhaps
+  Ptr<PacketPool> pool = packetPool ? Create<PacketPool> () : 0;
   Simulator::Schedule (Seconds (30.0), &GenerateTraffic,
-                       source, packetSize, numPackets, interPacketInterval);
+                       source, packetSize, numPackets, interPacketInterval, pool);
 
   // Output what we are doing
   NS_LOG_UNCOND ("Testing from node " << sourceNode << " to " << sinkNode << " with grid distance " << distance);
@@ -242,6 +284,18 @@ int main (int argc, char *argv[])
 
   Simulator::Stop (Seconds (33.0));
   Simulator::Run ();
+  NS_LOG_UNCOND ("simulated events: " << Simulator::GetEventCount ());
+  if (gridChannel != 0)
+    {
+      NS_LOG_UNCOND ("grid channel: " << gridChannel->GetEvaluated () << " receivers evaluated, "
+                     << gridChannel->GetSkipped () << " skipped, "
+                     << gridChannel->GetRebuilds () << " rebuilds");
+    }
+  if (pool != 0)
+    {
+      NS_LOG_UNCOND ("packet pool: " << pool->GetHits () << " reused, " << pool->GetMisses ()
+                     << " allocated, hit rate " << pool->GetHitRate ());
+    }
   Simulator::Destroy ();
 
   return 0;
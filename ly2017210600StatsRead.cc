@@ -0,0 +1,399 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Loads the columnar statistics written by "ly2017210600
+// --format=columnar" (see columnar-stats-format.h) into one
+// tab-separated table with a row per run and a column per value:
+//
+// ./waf --run "ly2017210600StatsRead --in=sweep.lycol --out=sweep.tsv"
+//
+// --in takes files and directories (every *.lycol inside is read), so a
+// whole sweep directory loads at once:
+//
+// ./waf --run "ly2017210600StatsRead --in=sweep.lycol.d --select=delay --out=delay.tsv"
+//
+// Columns are the run attributes followed by "context/name" for
+// singletons and "context/name.field" for statistic fields, in order of
+// first appearance.  --select keeps the value columns containing the
+// given text.  Files are mapped and decoded in parallel.
+//
+// --sketch=K merges the delay histograms written under key K (see
+// delay-sketch-calculator.h) over all runs with the same experiment,
+// strategy and input, and prints their quantiles instead:
+//
+// ./waf --run "ly2017210600StatsRead --in=sweep.lycol --sketch=delay4-sketch"
+//
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ns3/command-line.h"
+#include "columnar-stats-format.h"
+#include "delay-sketch.h"
+
+using namespace ns3;
+using namespace std;
+
+struct RunRow
+{
+  vector<pair<string, string> > attributes;
+  vector<pair<string, string> > values;
+};
+
+static bool
+EndsWith (const string &s, const string &suffix)
+{
+  return s.size () >= suffix.size ()
+         && s.compare (s.size () - suffix.size (), suffix.size (), suffix) == 0;
+}
+
+static void
+AddInput (const string &path, vector<string> &files)
+{
+  struct stat st;
+  if (stat (path.c_str (), &st) != 0)
+    {
+      cerr << "Cannot open " << path << ": " << strerror (errno) << endl;
+      return;
+    }
+  if (!S_ISDIR (st.st_mode))
+    {
+      files.push_back (path);
+      return;
+    }
+  DIR *dir = opendir (path.c_str ());
+  if (dir == 0)
+    {
+      return;
+    }
+  vector<string> names;
+  for (struct dirent *e = readdir (dir); e != 0; e = readdir (dir))
+    {
+      if (EndsWith (e->d_name, ".lycol"))
+        {
+          names.push_back (path + "/" + e->d_name);
+        }
+    }
+  closedir (dir);
+  sort (names.begin (), names.end ());
+  files.insert (files.end (), names.begin (), names.end ());
+}
+
+/**
+ * Decode every chunk of one file into rows.
+ */
+static bool
+ReadFile (const string &name, const string &select, vector<RunRow> &rows)
+{
+  int fd = open (name.c_str (), O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat (fd, &st) != 0)
+    {
+      cerr << "Cannot open " << name << ": " << strerror (errno) << endl;
+      if (fd >= 0)
+        {
+          close (fd);
+        }
+      return false;
+    }
+  if (st.st_size == 0)
+    {
+      close (fd);
+      return true;
+    }
+  void *map = mmap (0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (map == MAP_FAILED)
+    {
+      cerr << "Cannot map " << name << ": " << strerror (errno) << endl;
+      return false;
+    }
+
+  const uint8_t *p = static_cast<const uint8_t *> (map);
+  size_t left = st.st_size;
+  colstats::Chunk chunk;
+  bool ok = true;
+  while (left > 0)
+    {
+      if (!chunk.Parse (p, left))
+        {
+          cerr << name << ": bad or truncated chunk at byte " << st.st_size - left << endl;
+          ok = false;
+          break;
+        }
+      RunRow row;
+      for (uint32_t a = 0; a < chunk.GetAttributes (); ++a)
+        {
+          row.attributes.push_back (make_pair (chunk.AttributeKey (a), chunk.AttributeValue (a)));
+        }
+      for (uint32_t r = 0; r < chunk.GetRows (); ++r)
+        {
+          string column = chunk.String (chunk.Context ()[r]) + "/" + chunk.String (chunk.Name ()[r]);
+          string field = chunk.String (chunk.Field ()[r]);
+          if (!field.empty ())
+            {
+              column += "." + field;
+            }
+          if (!select.empty () && column.find (select) == string::npos)
+            {
+              continue;
+            }
+          string value;
+          if (chunk.Type ()[r] == colstats::STRING)
+            {
+              value = chunk.String (chunk.Text ()[r]);
+            }
+          else
+            {
+              char buf[32];
+              snprintf (buf, sizeof (buf), "%.15g", chunk.Value ()[r]);
+              value = buf;
+            }
+          row.values.push_back (make_pair (column, value));
+        }
+      rows.push_back (row);
+      p += chunk.GetSize ();
+      left -= chunk.GetSize ();
+    }
+  munmap (map, st.st_size);
+  return ok;
+}
+
+static string
+Attribute (const RunRow &row, const string &key)
+{
+  for (size_t a = 0; a < row.attributes.size (); ++a)
+    {
+      if (row.attributes[a].first == key)
+        {
+          return row.attributes[a].second;
+        }
+    }
+  return string ();
+}
+
+/**
+ * Sum the "K-hist-<ns>" buckets of every run per experiment/strategy/input
+ * and write the quantiles of each group.
+ */
+static void
+MergeSketches (const vector<vector<RunRow> > &perFile, const string &key, ostream &table)
+{
+  string marker = "/" + key + "-hist-";
+  vector<string> groups;
+  map<string, pair<DelaySketch, uint32_t> > sketches;
+  for (size_t f = 0; f < perFile.size (); ++f)
+    {
+      for (size_t r = 0; r < perFile[f].size (); ++r)
+        {
+          const RunRow &row = perFile[f][r];
+          string group = Attribute (row, "experiment") + "\t" + Attribute (row, "strategy")
+            + "\t" + Attribute (row, "input");
+          if (sketches.find (group) == sketches.end ())
+            {
+              groups.push_back (group);
+            }
+          pair<DelaySketch, uint32_t> &entry = sketches[group];
+          ++entry.second;
+          for (size_t v = 0; v < row.values.size (); ++v)
+            {
+              const string &column = row.values[v].first;
+              string::size_type at = column.find (marker);
+              if (at != string::npos)
+                {
+                  entry.first.AddBucketCount (strtoull (column.c_str () + at + marker.size (), 0, 10),
+                                              strtoull (row.values[v].second.c_str (), 0, 10));
+                }
+            }
+        }
+    }
+
+  table << "experiment\tstrategy\tinput\truns\tcount\tp50_ns\tp90_ns\tp99_ns\tp99.9_ns\n";
+  for (size_t g = 0; g < groups.size (); ++g)
+    {
+      const pair<DelaySketch, uint32_t> &entry = sketches[groups[g]];
+      const DelaySketch &sketch = entry.first;
+      table << groups[g] << "\t" << entry.second << "\t" << sketch.GetCount ()
+            << "\t" << sketch.Quantile (0.5) << "\t" << sketch.Quantile (0.9)
+            << "\t" << sketch.Quantile (0.99) << "\t" << sketch.Quantile (0.999) << "\n";
+    }
+}
+
+int main (int argc, char *argv[])
+{
+  string in;
+  string out;
+  string select;
+  string sketch;
+  uint32_t threads = 0;
+
+  CommandLine cmd;
+  cmd.AddValue ("in", "Comma-separated .lycol files or directories", in);
+  cmd.AddValue ("out", "Table to write (default: standard output)", out);
+  cmd.AddValue ("select", "Keep only value columns containing this text", select);
+  cmd.AddValue ("sketch", "Merge the delay histograms of this key per experiment/strategy/input", sketch);
+  cmd.AddValue ("threads", "Files decoded in parallel (0 = one per core)", threads);
+  cmd.Parse (argc, argv);
+
+  vector<string> files;
+  istringstream list (in);
+  string path;
+  while (getline (list, path, ','))
+    {
+      if (!path.empty ())
+        {
+          AddInput (path, files);
+        }
+    }
+  if (files.empty ())
+    {
+      cerr << "Usage: ly2017210600StatsRead --in=<file.lycol|dir>[,...] [--out=<table.tsv>]" << endl;
+      return 1;
+    }
+  if (threads == 0)
+    {
+      threads = max (1u, thread::hardware_concurrency ());
+    }
+  threads = min<uint32_t> (threads, files.size ());
+
+  vector<vector<RunRow> > perFile (files.size ());
+  atomic<uint32_t> next (0);
+  atomic<uint32_t> failed (0);
+  vector<thread> workers;
+  for (uint32_t w = 0; w < threads; ++w)
+    {
+      workers.push_back (thread ([&] ()
+        {
+          for (uint32_t i = next++; i < files.size (); i = next++)
+            {
+              if (!ReadFile (files[i], select, perFile[i]))
+                {
+                  ++failed;
+                }
+            }
+        }));
+    }
+  for (uint32_t w = 0; w < workers.size (); ++w)
+    {
+      workers[w].join ();
+    }
+
+  ofstream file;
+  if (!out.empty ())
+    {
+      file.open (out.c_str ());
+      if (!file)
+        {
+          cerr << "Cannot write " << out << endl;
+          return 1;
+        }
+    }
+  ostream &table = out.empty () ? cout : file;
+
+  if (!sketch.empty ())
+    {
+      MergeSketches (perFile, sketch, table);
+      table.flush ();
+      return failed == 0 ? 0 : 1;
+    }
+
+  // Columns in order of first appearance, files in command-line order.
+  vector<string> attrColumns;
+  vector<string> valueColumns;
+  map<string, size_t> attrIndex;
+  map<string, size_t> valueIndex;
+  size_t runs = 0;
+  for (size_t f = 0; f < perFile.size (); ++f)
+    {
+      for (size_t r = 0; r < perFile[f].size (); ++r)
+        {
+          const RunRow &row = perFile[f][r];
+          for (size_t a = 0; a < row.attributes.size (); ++a)
+            {
+              if (attrIndex.insert (make_pair (row.attributes[a].first, attrColumns.size ())).second)
+                {
+                  attrColumns.push_back (row.attributes[a].first);
+                }
+            }
+          for (size_t v = 0; v < row.values.size (); ++v)
+            {
+              if (valueIndex.insert (make_pair (row.values[v].first, valueColumns.size ())).second)
+                {
+                  valueColumns.push_back (row.values[v].first);
+                }
+            }
+          ++runs;
+        }
+    }
+
+  for (size_t c = 0; c < attrColumns.size (); ++c)
+    {
+      table << (c ? "\t" : "") << attrColumns[c];
+    }
+  for (size_t c = 0; c < valueColumns.size (); ++c)
+    {
+      table << (attrColumns.empty () && c == 0 ? "" : "\t") << valueColumns[c];
+    }
+  table << "\n";
+
+  vector<string> cells;
+  for (size_t f = 0; f < perFile.size (); ++f)
+    {
+      for (size_t r = 0; r < perFile[f].size (); ++r)
+        {
+          const RunRow &row = perFile[f][r];
+          cells.assign (attrColumns.size () + valueColumns.size (), string ());
+          for (size_t a = 0; a < row.attributes.size (); ++a)
+            {
+              string &cell = cells[attrIndex[row.attributes[a].first]];
+              if (cell.empty ())
+                {
+                  cell = row.attributes[a].second;
+                }
+            }
+          for (size_t v = 0; v < row.values.size (); ++v)
+            {
+              cells[attrColumns.size () + valueIndex[row.values[v].first]] = row.values[v].second;
+            }
+          for (size_t c = 0; c < cells.size (); ++c)
+            {
+              table << (c ? "\t" : "") << cells[c];
+            }
+          table << "\n";
+        }
+    }
+  table.flush ();
+
+  cerr << files.size () << " files, " << runs << " runs, "
+       << valueColumns.size () << " value columns" << endl;
+  return failed == 0 ? 0 : 1;
+}
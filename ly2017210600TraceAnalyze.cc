@@ -0,0 +1,426 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Post-processing of NetAnim traces such as ly4-1000-5-10.xml.
+//
+// Every file is memory-mapped and scanned once.  <pr uId fId fbTx>
+// records are the transmissions, <wpr uId tId fbRx> the receptions of
+// the transmission with the same uId that came last; joining the two
+// gives per-hop delays.  The scan keeps only flat arrays indexed by uId
+// and node id and does not allocate per record.
+//
+// For each input "<name>.xml" two tab-separated tables are written:
+//
+//   <name>-nodes.tsv  node tx rx collisions hop_delay_mean_us hop_delay_max_us
+//   <name>-links.tsv  from to frames hop_delay_mean_us hop_delay_min_us hop_delay_max_us
+//
+// tx counts every frame a node put on the air, i.e. its own and its
+// forwarding load.  NetAnim does not record reception failures, so
+// collisions are estimated: a reception that starts less than
+// --airtimeUs after the previous one at the same node overlaps it.
+//
+// Several files are processed in parallel:
+//
+// ./waf --run "ly2017210600TraceAnalyze --in=ly4-1000-0-10.xml,ly4-1000-5-10.xml"
+//
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ns3/command-line.h"
+
+using namespace ns3;
+using namespace std;
+
+namespace {
+
+struct Transmission
+{
+  uint32_t node;
+  double time;
+};
+
+struct NodeStats
+{
+  uint64_t tx;
+  uint64_t rx;
+  uint64_t collisions;
+  double delaySum;
+  double delayMax;
+  uint64_t delayCount;
+  double lastRx;
+};
+
+struct LinkStats
+{
+  uint64_t frames;
+  double delaySum;
+  double delayMin;
+  double delayMax;
+};
+
+class TraceAnalysis
+{
+public:
+  TraceAnalysis (double airtime)
+    : m_airtime (airtime),
+      m_records (0),
+      m_unmatched (0)
+  {
+  }
+
+  bool Run (const string &name);
+  bool Write (const string &prefix) const;
+
+  uint64_t GetRecords (void) const
+  {
+    return m_records;
+  }
+
+  uint64_t GetUnmatched (void) const
+  {
+    return m_unmatched;
+  }
+
+private:
+  void Scan (const char *p, const char *end);
+  void AddNode (uint32_t node);
+  void OnTx (uint64_t uid, uint32_t node, double time);
+  void OnRx (uint64_t uid, uint32_t node, double time);
+
+  static const char *Attribute (const char *p, const char *end, const char *name, size_t len);
+
+  double m_airtime;
+  uint64_t m_records;
+  uint64_t m_unmatched;
+  vector<Transmission> m_tx;      //!< last transmission of each uId
+  vector<NodeStats> m_nodes;
+  vector<LinkStats> m_links;      //!< m_nodes.size () squared, row = sender
+};
+
+const char *
+TraceAnalysis::Attribute (const char *p, const char *end, const char *name, size_t len)
+{
+  // attributes are written as name="value"
+  while (p + len + 2 <= end)
+    {
+      const char *q = static_cast<const char *> (memchr (p, name[0], end - p));
+      if (q == 0 || q + len + 2 > end)
+        {
+          return 0;
+        }
+      if (memcmp (q, name, len) == 0 && q[len] == '=' && q[len + 1] == '"'
+          && (q[-1] == ' ' || q[-1] == '\t'))
+        {
+          return q + len + 2;
+        }
+      p = q + 1;
+    }
+  return 0;
+}
+
+void
+TraceAnalysis::AddNode (uint32_t node)
+{
+  if (node < m_nodes.size ())
+    {
+      return;
+    }
+  // Nodes are declared up front, so the link matrix is resized at most
+  // once per <node> line, never inside the packet records.
+  uint32_t old = m_nodes.size ();
+  uint32_t n = node + 1;
+  NodeStats zero = { 0, 0, 0, 0.0, 0.0, 0, -1.0 };
+  m_nodes.resize (n, zero);
+  LinkStats none = { 0, 0.0, numeric_limits<double>::max (), 0.0 };
+  vector<LinkStats> links (static_cast<size_t> (n) * n, none);
+  for (uint32_t f = 0; f < old; ++f)
+    {
+      copy (m_links.begin () + static_cast<size_t> (f) * old,
+            m_links.begin () + static_cast<size_t> (f + 1) * old,
+            links.begin () + static_cast<size_t> (f) * n);
+    }
+  m_links.swap (links);
+}
+
+void
+TraceAnalysis::OnTx (uint64_t uid, uint32_t node, double time)
+{
+  AddNode (node);
+  if (uid >= m_tx.size ())
+    {
+      Transmission none = { numeric_limits<uint32_t>::max (), 0.0 };
+      m_tx.resize (max<size_t> (uid + 1, m_tx.size () * 2), none);
+    }
+  m_tx[uid].node = node;
+  m_tx[uid].time = time;
+  ++m_nodes[node].tx;
+}
+
+void
+TraceAnalysis::OnRx (uint64_t uid, uint32_t node, double time)
+{
+  AddNode (node);
+  NodeStats &rx = m_nodes[node];
+  ++rx.rx;
+  if (rx.lastRx >= 0 && time - rx.lastRx < m_airtime)
+    {
+      ++rx.collisions;
+    }
+  rx.lastRx = time;
+
+  if (uid >= m_tx.size () || m_tx[uid].node == numeric_limits<uint32_t>::max ())
+    {
+      ++m_unmatched;
+      return;
+    }
+  const Transmission &tx = m_tx[uid];
+  double delay = time - tx.time;
+  rx.delaySum += delay;
+  rx.delayMax = max (rx.delayMax, delay);
+  ++rx.delayCount;
+
+  LinkStats &link = m_links[static_cast<size_t> (tx.node) * m_nodes.size () + node];
+  ++link.frames;
+  link.delaySum += delay;
+  link.delayMin = min (link.delayMin, delay);
+  link.delayMax = max (link.delayMax, delay);
+}
+
+void
+TraceAnalysis::Scan (const char *p, const char *end)
+{
+  while (p < end)
+    {
+      const char *lt = static_cast<const char *> (memchr (p, '<', end - p));
+      if (lt == 0)
+        {
+          break;
+        }
+      const char *gt = static_cast<const char *> (memchr (lt, '>', end - lt));
+      if (gt == 0)
+        {
+          break;
+        }
+      const char *tag = lt + 1;
+      if (gt - tag > 4 && memcmp (tag, "wpr ", 4) == 0)
+        {
+          const char *uid = Attribute (tag, gt, "uId", 3);
+          const char *to = Attribute (tag, gt, "tId", 3);
+          const char *t = Attribute (tag, gt, "fbRx", 4);
+          if (uid && to && t)
+            {
+              OnRx (strtoull (uid, 0, 10), strtoul (to, 0, 10), strtod (t, 0));
+              ++m_records;
+            }
+        }
+      else if (gt - tag > 3 && memcmp (tag, "pr ", 3) == 0)
+        {
+          const char *uid = Attribute (tag, gt, "uId", 3);
+          const char *from = Attribute (tag, gt, "fId", 3);
+          const char *t = Attribute (tag, gt, "fbTx", 4);
+          if (uid && from && t)
+            {
+              OnTx (strtoull (uid, 0, 10), strtoul (from, 0, 10), strtod (t, 0));
+              ++m_records;
+            }
+        }
+      else if (gt - tag > 5 && memcmp (tag, "node ", 5) == 0)
+        {
+          const char *id = Attribute (tag, gt, "id", 2);
+          if (id)
+            {
+              AddNode (strtoul (id, 0, 10));
+            }
+        }
+      p = gt + 1;
+    }
+}
+
+bool
+TraceAnalysis::Run (const string &name)
+{
+  int fd = open (name.c_str (), O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat (fd, &st) != 0)
+    {
+      cerr << "Cannot open " << name << ": " << strerror (errno) << endl;
+      if (fd >= 0)
+        {
+          close (fd);
+        }
+      return false;
+    }
+  if (st.st_size == 0)
+    {
+      close (fd);
+      return true;
+    }
+  void *map = mmap (0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED)
+    {
+      cerr << "Cannot map " << name << ": " << strerror (errno) << endl;
+      close (fd);
+      return false;
+    }
+  madvise (map, st.st_size, MADV_SEQUENTIAL);
+  const char *begin = static_cast<const char *> (map);
+  Scan (begin, begin + st.st_size);
+  munmap (map, st.st_size);
+  close (fd);
+  return true;
+}
+
+bool
+TraceAnalysis::Write (const string &prefix) const
+{
+  string nodesName = prefix + "-nodes.tsv";
+  FILE *nodes = fopen (nodesName.c_str (), "w");
+  if (nodes == 0)
+    {
+      cerr << "Cannot write " << nodesName << endl;
+      return false;
+    }
+  fprintf (nodes, "node\ttx\trx\tcollisions\thop_delay_mean_us\thop_delay_max_us\n");
+  for (uint32_t n = 0; n < m_nodes.size (); ++n)
+    {
+      const NodeStats &s = m_nodes[n];
+      double mean = s.delayCount ? s.delaySum / s.delayCount : 0.0;
+      fprintf (nodes, "%u\t%llu\t%llu\t%llu\t%.3f\t%.3f\n", n,
+               static_cast<unsigned long long> (s.tx), static_cast<unsigned long long> (s.rx),
+               static_cast<unsigned long long> (s.collisions), mean * 1e6, s.delayMax * 1e6);
+    }
+  fclose (nodes);
+
+  string linksName = prefix + "-links.tsv";
+  FILE *links = fopen (linksName.c_str (), "w");
+  if (links == 0)
+    {
+      cerr << "Cannot write " << linksName << endl;
+      return false;
+    }
+  fprintf (links, "from\tto\tframes\thop_delay_mean_us\thop_delay_min_us\thop_delay_max_us\n");
+  uint32_t n = m_nodes.size ();
+  for (uint32_t f = 0; f < n; ++f)
+    {
+      for (uint32_t t = 0; t < n; ++t)
+        {
+          const LinkStats &l = m_links[static_cast<size_t> (f) * n + t];
+          if (l.frames == 0)
+            {
+              continue;
+            }
+          fprintf (links, "%u\t%u\t%llu\t%.3f\t%.3f\t%.3f\n", f, t,
+                   static_cast<unsigned long long> (l.frames),
+                   l.delaySum / l.frames * 1e6, l.delayMin * 1e6, l.delayMax * 1e6);
+        }
+    }
+  fclose (links);
+  return true;
+}
+
+} // anonymous namespace
+
+int main (int argc, char *argv[])
+{
+  string in;
+  double airtimeUs = 1200;
+  uint32_t threads = 0;
+
+  CommandLine cmd;
+  cmd.AddValue ("in", "Comma-separated NetAnim XML files", in);
+  cmd.AddValue ("airtimeUs", "Receptions closer than this at one node count as a collision", airtimeUs);
+  cmd.AddValue ("threads", "Files analysed in parallel (0 = one per core)", threads);
+  cmd.Parse (argc, argv);
+
+  vector<string> files;
+  istringstream list (in);
+  string file;
+  while (getline (list, file, ','))
+    {
+      if (!file.empty ())
+        {
+          files.push_back (file);
+        }
+    }
+  if (files.empty ())
+    {
+      cerr << "Usage: ly2017210600TraceAnalyze --in=<a.xml>[,<b.xml>...]" << endl;
+      return 1;
+    }
+  if (threads == 0)
+    {
+      threads = max (1u, thread::hardware_concurrency ());
+    }
+  threads = min<uint32_t> (threads, files.size ());
+
+  atomic<uint32_t> next (0);
+  atomic<uint32_t> failed (0);
+  vector<string> summaries (files.size ());
+  vector<thread> workers;
+  for (uint32_t w = 0; w < threads; ++w)
+    {
+      workers.push_back (thread ([&] ()
+        {
+          for (uint32_t i = next++; i < files.size (); i = next++)
+            {
+              TraceAnalysis analysis (airtimeUs * 1e-6);
+              string prefix = files[i];
+              if (prefix.size () > 4 && prefix.compare (prefix.size () - 4, 4, ".xml") == 0)
+                {
+                  prefix.erase (prefix.size () - 4);
+                }
+              if (!analysis.Run (files[i]) || !analysis.Write (prefix))
+                {
+                  ++failed;
+                  continue;
+                }
+              ostringstream summary;
+              summary << files[i] << ": " << analysis.GetRecords () << " records, "
+                      << analysis.GetUnmatched () << " receptions without transmission -> "
+                      << prefix << "-nodes.tsv, " << prefix << "-links.tsv";
+              summaries[i] = summary.str ();
+            }
+        }));
+    }
+  for (uint32_t w = 0; w < workers.size (); ++w)
+    {
+      workers[w].join ();
+    }
+  for (uint32_t i = 0; i < summaries.size (); ++i)
+    {
+      if (!summaries[i].empty ())
+        {
+          cout << summaries[i] << endl;
+        }
+    }
+  return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,606 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Precomputed shortest-path routing without control traffic.
+//
+// All nodes share one next-hop matrix: entry (i, j) is the node i
+// forwards to for destination j.  It is built once, when the first
+// packet is routed, from the radio links of the channel.  The power b
+// receives from a is a's TxPowerEnd + TxGain, less the loss the
+// channel's PropagationLossModel computes between them, plus b's
+// RxGain.  Against b's thermal noise (channel width and RxNoiseFigure)
+// that gives an SNR, and a -> b is a link if a frame of FrameBytes sent
+// at the data mode of a's station manager (its basic mode for adaptive
+// managers) arrives with at least MinSuccessRate according to the error
+// rate model (NistErrorRateModel, the YansWifiPhyHelper default).
+// Merely detecting a frame is not enough: at the EnergyDetectionThreshold
+// a DSSS frame is far below the noise and almost never decodes, and the
+// min-hop search would pick exactly those longest, weakest links.
+// SetThreshold() replaces the test with a fixed received power.  A
+// breadth-first search per destination then gives min-hop routes.
+//
+// Ipv4StaticRouting would hold N - 1 host routes per node in a list it
+// searches linearly, about a million entries for 1000 nodes; the matrix
+// is 2 bytes per pair and a lookup is one index.  The routes never
+// change, so this is meant for static grids.
+//
+// Each node's WiFi device must be on IPv4 interface 1.  In the list
+// routing the protocol goes above static routing, whose on-link network
+// route would otherwise send every packet directly.
+//
+#ifndef LY_NEXT_HOP_MATRIX_ROUTING_H
+#define LY_NEXT_HOP_MATRIX_ROUTING_H
+
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#include "ns3/abort.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/pointer.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/mobility-model.h"
+#include "ns3/ipv4.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/ipv4-routing-protocol.h"
+#include "ns3/ipv4-routing-helper.h"
+#include "ns3/output-stream-wrapper.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/wifi-phy.h"
+#include "ns3/wifi-mode.h"
+#include "ns3/wifi-tx-vector.h"
+#include "ns3/wifi-remote-station-manager.h"
+#include "ns3/error-rate-model.h"
+#include "ns3/nist-error-rate-model.h"
+#include "ns3/yans-wifi-channel.h"
+
+namespace ns3 {
+
+/**
+ * Next hops of every node pair, shared by all NextHopMatrixRouting
+ * instances of a run.
+ */
+class NextHopMatrix : public SimpleRefCount<NextHopMatrix>
+{
+public:
+  static const uint16_t UNREACHABLE = 0xffff;
+
+  NextHopMatrix ();
+
+  /**
+   * \param rate packet success rate a link needs
+   * \param frameBytes size of the frame it applies to (MAC header and
+   *        FCS included)
+   */
+  void SetMinSuccessRate (double rate, uint32_t frameBytes = 1064);
+  /// \param model error rate model of the receivers
+  void SetErrorRateModel (Ptr<ErrorRateModel> model);
+  /// \param dbm received power a link needs instead, NaN to use the success rate
+  void SetThreshold (double dbm);
+
+  /// build the matrix from the current nodes, once
+  void Build (void);
+  bool IsBuilt (void) const;
+
+  uint32_t GetN (void) const;
+  /// \return matrix index of the node, UNREACHABLE if it has none
+  uint32_t GetIndex (uint32_t nodeId) const;
+  /// \return matrix index of the address, UNREACHABLE if unknown
+  uint32_t Lookup (Ipv4Address address) const;
+  uint16_t GetNextHop (uint32_t from, uint32_t to) const;
+  Ipv4Address GetAddress (uint32_t index) const;
+  uint32_t GetLinks (void) const;
+
+private:
+  static LogComponent g_log;           //!< for the NS_LOG macros
+
+  double m_threshold;
+  double m_minSuccessRate;
+  uint32_t m_frameBytes;
+  Ptr<ErrorRateModel> m_error;
+  bool m_built;
+  uint32_t m_n;
+  uint32_t m_links;
+  std::vector<Ipv4Address> m_address;
+  std::vector<uint32_t> m_indexOfNode;             //!< by node id
+  std::unordered_map<uint32_t, uint32_t> m_indexOfAddress;
+  std::vector<uint16_t> m_next;                     //!< m_n x m_n
+};
+
+LogComponent NextHopMatrix::g_log ("NextHopMatrix", __FILE__);
+
+NextHopMatrix::NextHopMatrix ()
+  : m_threshold (std::numeric_limits<double>::quiet_NaN ()),
+    m_minSuccessRate (0.9),
+    m_frameBytes (1064),
+    m_built (false),
+    m_n (0),
+    m_links (0)
+{
+}
+
+void
+NextHopMatrix::SetMinSuccessRate (double rate, uint32_t frameBytes)
+{
+  NS_ABORT_MSG_IF (rate <= 0 || rate > 1, "Link success rate must be in (0, 1]");
+  m_minSuccessRate = rate;
+  m_frameBytes = frameBytes;
+}
+
+void
+NextHopMatrix::SetErrorRateModel (Ptr<ErrorRateModel> model)
+{
+  m_error = model;
+}
+
+void
+NextHopMatrix::SetThreshold (double dbm)
+{
+  m_threshold = dbm;
+}
+
+bool
+NextHopMatrix::IsBuilt (void) const
+{
+  return m_built;
+}
+
+void
+NextHopMatrix::Build (void)
+{
+  if (m_built)
+    {
+      return;
+    }
+  m_built = true;
+
+  // nodes with a WiFi device on interface 1
+  std::vector<Ptr<MobilityModel> > mobility;
+  std::vector<Ptr<WifiPhy> > phy;
+  m_indexOfNode.assign (NodeList::GetNNodes (), UNREACHABLE);
+  for (uint32_t id = 0; id < NodeList::GetNNodes (); ++id)
+    {
+      Ptr<Node> node = NodeList::GetNode (id);
+      Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+      if (ipv4 == 0 || ipv4->GetNInterfaces () < 2 || ipv4->GetNAddresses (1) == 0)
+        {
+          continue;
+        }
+      Ptr<WifiNetDevice> device = DynamicCast<WifiNetDevice> (ipv4->GetNetDevice (1));
+      Ptr<MobilityModel> position = node->GetObject<MobilityModel> ();
+      if (device == 0 || position == 0)
+        {
+          continue;
+        }
+      NS_ABORT_MSG_IF (m_address.size () >= UNREACHABLE, "Too many nodes for the next-hop matrix");
+      m_indexOfNode[id] = m_address.size ();
+      m_indexOfAddress[ipv4->GetAddress (1, 0).GetLocal ().Get ()] = m_address.size ();
+      m_address.push_back (ipv4->GetAddress (1, 0).GetLocal ());
+      mobility.push_back (position);
+      phy.push_back (device->GetPhy ());
+    }
+  m_n = m_address.size ();
+  if (m_n == 0)
+    {
+      return;
+    }
+
+  Ptr<YansWifiChannel> channel = DynamicCast<YansWifiChannel> (phy[0]->GetChannel ());
+  NS_ABORT_MSG_IF (channel == 0, "NextHopMatrix needs a YansWifiChannel");
+  PointerValue lossValue;
+  channel->GetAttribute ("PropagationLossModel", lossValue);
+  Ptr<PropagationLossModel> loss = lossValue.Get<PropagationLossModel> ();
+  NS_ABORT_MSG_IF (loss == 0, "The channel has no propagation loss model");
+
+  if (m_error == 0)
+    {
+      m_error = CreateObject<NistErrorRateModel> ();
+    }
+  std::vector<double> txDbm (m_n);
+  std::vector<double> rxGain (m_n);
+  std::vector<double> noiseW (m_n);
+  std::vector<WifiTxVector> txVector (m_n);
+  for (uint32_t i = 0; i < m_n; ++i)
+    {
+      DoubleValue power, txGain, gain, noiseFigure;
+      phy[i]->GetAttribute ("TxPowerEnd", power);
+      phy[i]->GetAttribute ("TxGain", txGain);
+      phy[i]->GetAttribute ("RxGain", gain);
+      phy[i]->GetAttribute ("RxNoiseFigure", noiseFigure);
+      txDbm[i] = power.Get () + txGain.Get ();
+      rxGain[i] = gain.Get ();
+      // thermal noise as InterferenceHelper computes it
+      double bandwidthHz = phy[i]->GetChannelWidth () * 1e6;
+      noiseW[i] = 1.3803e-23 * 290.0 * bandwidthHz * std::pow (10.0, noiseFigure.Get () / 10.0);
+
+      Ptr<WifiRemoteStationManager> manager =
+        DynamicCast<WifiNetDevice> (phy[i]->GetDevice ())->GetRemoteStationManager ();
+      StringValue dataMode;
+      WifiMode mode = manager->GetAttributeFailSafe ("DataMode", dataMode)
+        ? WifiMode (dataMode.Get ()) : manager->GetDefaultMode ();
+      txVector[i].SetMode (mode);
+      txVector[i].SetChannelWidth (phy[i]->GetChannelWidth ());
+      txVector[i].SetNss (1);
+    }
+
+  // in[b] lists the nodes that reach b, for the search from b backwards
+  std::vector<std::vector<uint16_t> > in (m_n);
+  m_links = 0;
+  for (uint32_t a = 0; a < m_n; ++a)
+    {
+      for (uint32_t b = 0; b < m_n; ++b)
+        {
+          if (a == b)
+            {
+              continue;
+            }
+          double rxDbm = loss->CalcRxPower (txDbm[a], mobility[a], mobility[b]) + rxGain[b];
+          bool link;
+          if (!std::isnan (m_threshold))
+            {
+              link = rxDbm >= m_threshold;
+            }
+          else
+            {
+              double snr = std::pow (10.0, (rxDbm - 30) / 10.0) / noiseW[b];
+              link = m_error->GetChunkSuccessRate (txVector[a].GetMode (), txVector[a], snr,
+                                                   8 * m_frameBytes) >= m_minSuccessRate;
+            }
+          if (link)
+            {
+              in[b].push_back (a);
+              ++m_links;
+            }
+        }
+    }
+
+  m_next.assign (static_cast<size_t> (m_n) * m_n, UNREACHABLE);
+  std::vector<uint16_t> queue (m_n);
+  for (uint32_t dst = 0; dst < m_n; ++dst)
+    {
+      // a node first reached from v forwards to v
+      m_next[static_cast<size_t> (dst) * m_n + dst] = dst;
+      uint32_t head = 0;
+      uint32_t tail = 0;
+      queue[tail++] = dst;
+      while (head < tail)
+        {
+          uint16_t v = queue[head++];
+          for (uint32_t k = 0; k < in[v].size (); ++k)
+            {
+              uint16_t u = in[v][k];
+              uint16_t &hop = m_next[static_cast<size_t> (u) * m_n + dst];
+              if (hop == UNREACHABLE)
+                {
+                  hop = v;
+                  queue[tail++] = u;
+                }
+            }
+        }
+    }
+  NS_LOG_INFO (m_n << " nodes, " << m_links << " links");
+}
+
+uint32_t
+NextHopMatrix::GetN (void) const
+{
+  return m_n;
+}
+
+uint32_t
+NextHopMatrix::GetIndex (uint32_t nodeId) const
+{
+  return nodeId < m_indexOfNode.size () ? m_indexOfNode[nodeId] : UNREACHABLE;
+}
+
+uint32_t
+NextHopMatrix::Lookup (Ipv4Address address) const
+{
+  std::unordered_map<uint32_t, uint32_t>::const_iterator it = m_indexOfAddress.find (address.Get ());
+  return it != m_indexOfAddress.end () ? it->second : UNREACHABLE;
+}
+
+uint16_t
+NextHopMatrix::GetNextHop (uint32_t from, uint32_t to) const
+{
+  return m_next[static_cast<size_t> (from) * m_n + to];
+}
+
+Ipv4Address
+NextHopMatrix::GetAddress (uint32_t index) const
+{
+  return m_address[index];
+}
+
+uint32_t
+NextHopMatrix::GetLinks (void) const
+{
+  return m_links;
+}
+
+/**
+ * Routes unicast packets along a shared NextHopMatrix.
+ */
+class NextHopMatrixRouting : public Ipv4RoutingProtocol
+{
+public:
+  static TypeId GetTypeId (void);
+
+  NextHopMatrixRouting ();
+  virtual ~NextHopMatrixRouting ();
+
+  void SetMatrix (Ptr<NextHopMatrix> matrix);
+
+  virtual Ptr<Ipv4Route> RouteOutput (Ptr<Packet> p, const Ipv4Header &header,
+                                      Ptr<NetDevice> oif, Socket::SocketErrno &sockerr);
+  virtual bool RouteInput (Ptr<const Packet> p, const Ipv4Header &header,
+                           Ptr<const NetDevice> idev, UnicastForwardCallback ucb,
+                           MulticastForwardCallback mcb, LocalDeliverCallback lcb,
+                           ErrorCallback ecb);
+  virtual void NotifyInterfaceUp (uint32_t interface);
+  virtual void NotifyInterfaceDown (uint32_t interface);
+  virtual void NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address);
+  virtual void NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address);
+  virtual void SetIpv4 (Ptr<Ipv4> ipv4);
+  virtual void PrintRoutingTable (Ptr<OutputStreamWrapper> stream, Time::Unit unit = Time::S) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  /// \return the route towards destination, 0 if there is none
+  Ptr<Ipv4Route> Route (Ipv4Address destination);
+
+  Ptr<Ipv4> m_ipv4;
+  Ptr<NextHopMatrix> m_matrix;
+};
+
+TypeId
+NextHopMatrixRouting::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NextHopMatrixRouting")
+    .SetParent<Ipv4RoutingProtocol> ()
+    .SetGroupName ("Internet")
+    .AddConstructor<NextHopMatrixRouting> ()
+  ;
+  return tid;
+}
+
+NextHopMatrixRouting::NextHopMatrixRouting ()
+{
+}
+
+NextHopMatrixRouting::~NextHopMatrixRouting ()
+{
+}
+
+void
+NextHopMatrixRouting::DoDispose (void)
+{
+  m_ipv4 = 0;
+  m_matrix = 0;
+  Ipv4RoutingProtocol::DoDispose ();
+}
+
+void
+NextHopMatrixRouting::SetMatrix (Ptr<NextHopMatrix> matrix)
+{
+  m_matrix = matrix;
+}
+
+Ptr<Ipv4Route>
+NextHopMatrixRouting::Route (Ipv4Address destination)
+{
+  m_matrix->Build ();
+  uint32_t self = m_matrix->GetIndex (m_ipv4->GetObject<Node> ()->GetId ());
+  uint32_t to = m_matrix->Lookup (destination);
+  if (self == NextHopMatrix::UNREACHABLE || to == NextHopMatrix::UNREACHABLE)
+    {
+      return 0;
+    }
+  uint16_t next = m_matrix->GetNextHop (self, to);
+  if (next == NextHopMatrix::UNREACHABLE)
+    {
+      return 0;
+    }
+  Ptr<Ipv4Route> route = Create<Ipv4Route> ();
+  route->SetDestination (destination);
+  route->SetGateway (m_matrix->GetAddress (next));
+  route->SetSource (m_ipv4->GetAddress (1, 0).GetLocal ());
+  route->SetOutputDevice (m_ipv4->GetNetDevice (1));
+  return route;
+}
+
+Ptr<Ipv4Route>
+NextHopMatrixRouting::RouteOutput (Ptr<Packet> p, const Ipv4Header &header,
+                                   Ptr<NetDevice> oif, Socket::SocketErrno &sockerr)
+{
+  Ipv4Address destination = header.GetDestination ();
+  Ptr<Ipv4Route> route;
+  if (!destination.IsBroadcast () && !destination.IsMulticast ()
+      && (oif == 0 || oif == m_ipv4->GetNetDevice (1)))
+    {
+      route = Route (destination);
+    }
+  // broadcasts and unknown destinations are left to the next protocol
+  sockerr = route != 0 ? Socket::ERROR_NOTERROR : Socket::ERROR_NOROUTETOHOST;
+  return route;
+}
+
+bool
+NextHopMatrixRouting::RouteInput (Ptr<const Packet> p, const Ipv4Header &header,
+                                  Ptr<const NetDevice> idev, UnicastForwardCallback ucb,
+                                  MulticastForwardCallback mcb, LocalDeliverCallback lcb,
+                                  ErrorCallback ecb)
+{
+  Ipv4Address destination = header.GetDestination ();
+  uint32_t iif = m_ipv4->GetInterfaceForDevice (idev);
+  if (m_ipv4->IsDestinationAddress (destination, iif))
+    {
+      if (!lcb.IsNull ())
+        {
+          lcb (p, header, iif);
+          return true;
+        }
+      return false;
+    }
+  if (destination.IsMulticast () || destination.IsBroadcast ())
+    {
+      return false;
+    }
+  if (!m_ipv4->IsForwarding (iif))
+    {
+      ecb (p, header, Socket::ERROR_NOROUTETOHOST);
+      return true;
+    }
+  Ptr<Ipv4Route> route = Route (destination);
+  if (route == 0)
+    {
+      ecb (p, header, Socket::ERROR_NOROUTETOHOST);
+      return true;
+    }
+  ucb (route, p, header);
+  return true;
+}
+
+void
+NextHopMatrixRouting::NotifyInterfaceUp (uint32_t interface)
+{
+}
+
+void
+NextHopMatrixRouting::NotifyInterfaceDown (uint32_t interface)
+{
+}
+
+void
+NextHopMatrixRouting::NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address)
+{
+}
+
+void
+NextHopMatrixRouting::NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address)
+{
+}
+
+void
+NextHopMatrixRouting::SetIpv4 (Ptr<Ipv4> ipv4)
+{
+  m_ipv4 = ipv4;
+}
+
+void
+NextHopMatrixRouting::PrintRoutingTable (Ptr<OutputStreamWrapper> stream, Time::Unit unit) const
+{
+  std::ostream *os = stream->GetStream ();
+  *os << "Node: " << m_ipv4->GetObject<Node> ()->GetId ()
+      << ", Time: " << Simulator::Now ().As (unit)
+      << ", NextHopMatrixRouting table" << std::endl;
+  if (!m_matrix->IsBuilt ())
+    {
+      *os << "(not built yet)" << std::endl << std::endl;
+      return;
+    }
+  uint32_t self = m_matrix->GetIndex (m_ipv4->GetObject<Node> ()->GetId ());
+  *os << "Destination     Gateway" << std::endl;
+  for (uint32_t to = 0; to < m_matrix->GetN () && self != NextHopMatrix::UNREACHABLE; ++to)
+    {
+      uint16_t next = m_matrix->GetNextHop (self, to);
+      if (to == self || next == NextHopMatrix::UNREACHABLE)
+        {
+          continue;
+        }
+      std::ostringstream destination, gateway;
+      destination << m_matrix->GetAddress (to);
+      gateway << m_matrix->GetAddress (next);
+      *os << std::setw (16) << std::left << destination.str () << gateway.str () << std::endl;
+    }
+  *os << std::endl;
+}
+
+/**
+ * Installs NextHopMatrixRouting on nodes, all sharing one matrix.
+ */
+class NextHopMatrixRoutingHelper : public Ipv4RoutingHelper
+{
+public:
+  NextHopMatrixRoutingHelper ();
+
+  /// \param rate packet success rate a link needs, see NextHopMatrix
+  void SetMinSuccessRate (double rate);
+  /// \param dbm received power a link needs instead of a success rate
+  void SetThreshold (double dbm);
+  Ptr<NextHopMatrix> GetMatrix (void) const;
+
+  virtual NextHopMatrixRoutingHelper *Copy (void) const;
+  virtual Ptr<Ipv4RoutingProtocol> Create (Ptr<Node> node) const;
+
+private:
+  Ptr<NextHopMatrix> m_matrix;
+};
+
+NextHopMatrixRoutingHelper::NextHopMatrixRoutingHelper ()
+  : m_matrix (ns3::Create<NextHopMatrix> ())
+{
+}
+
+void
+NextHopMatrixRoutingHelper::SetMinSuccessRate (double rate)
+{
+  m_matrix->SetMinSuccessRate (rate);
+}
+
+void
+NextHopMatrixRoutingHelper::SetThreshold (double dbm)
+{
+  m_matrix->SetThreshold (dbm);
+}
+
+Ptr<NextHopMatrix>
+NextHopMatrixRoutingHelper::GetMatrix (void) const
+{
+  return m_matrix;
+}
+
+NextHopMatrixRoutingHelper *
+NextHopMatrixRoutingHelper::Copy (void) const
+{
+  // copies share the matrix
+  return new NextHopMatrixRoutingHelper (*this);
+}
+
+Ptr<Ipv4RoutingProtocol>
+NextHopMatrixRoutingHelper::Create (Ptr<Node> node) const
+{
+  Ptr<NextHopMatrixRouting> routing = CreateObject<NextHopMatrixRouting> ();
+  routing->SetMatrix (m_matrix);
+  return routing;
+}
+
+} // namespace ns3
+
+#endif /* LY_NEXT_HOP_MATRIX_ROUTING_H */
@@ -0,0 +1,177 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Per-node frame counters fed straight from the WifiMac trace sources.
+//
+// The counters of all nodes live in one flat array.  Each trace sink is
+// bound to the address of its node's slot and connected with
+// TraceConnectWithoutContext on the resolved WifiMac, so a frame costs
+// one increment: no Config path match and no context string.
+//
+#ifndef LY_NODE_TRACE_COUNTERS_H
+#define LY_NODE_TRACE_COUNTERS_H
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/abort.h"
+#include "ns3/callback.h"
+#include "ns3/packet.h"
+#include "ns3/net-device-container.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/wifi-mac.h"
+#include "ns3/stats-module.h"
+
+namespace ns3 {
+
+/**
+ * A counter per node that writes one "node[N] key count" singleton per
+ * selected node.
+ */
+class NodeCounterCalculator : public DataCalculator
+{
+public:
+  static TypeId GetTypeId (void);
+
+  NodeCounterCalculator ();
+  virtual ~NodeCounterCalculator ();
+
+  /**
+   * Size the counter array; must be called before any counter is
+   * connected, as sinks keep pointers into it.
+   * \param numNodes number of nodes
+   */
+  void SetNodes (uint32_t numNodes);
+  /**
+   * Include a node in the output.
+   * \param node the node id
+   */
+  void Select (uint32_t node);
+  /// Include every node in the output.
+  void SelectAll (void);
+
+  uint32_t GetCount (uint32_t node) const;
+
+  /**
+   * Count the frames of a WifiMac trace source of every wifi device.
+   * \param devices the devices, in any order
+   * \param traceSource "MacTx", "MacRx", ...
+   */
+  void ConnectMac (NetDeviceContainer devices, std::string traceSource);
+
+  virtual void Output (DataOutputCallback &callback) const;
+
+  /**
+   * Trace sink bound to one counter slot.
+   * \param counter the slot
+   * \param packet the traced packet
+   */
+  static void Increment (uint32_t *counter, Ptr<const Packet> packet);
+
+private:
+  std::vector<uint32_t> m_counts;
+  std::vector<bool> m_selected;
+};
+
+TypeId
+NodeCounterCalculator::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NodeCounterCalculator")
+    .SetParent<DataCalculator> ()
+    .SetGroupName ("Stats")
+    .AddConstructor<NodeCounterCalculator> ()
+  ;
+  return tid;
+}
+
+NodeCounterCalculator::NodeCounterCalculator ()
+{
+}
+
+NodeCounterCalculator::~NodeCounterCalculator ()
+{
+}
+
+void
+NodeCounterCalculator::SetNodes (uint32_t numNodes)
+{
+  m_counts.assign (numNodes, 0);
+  m_selected.assign (numNodes, false);
+}
+
+void
+NodeCounterCalculator::Select (uint32_t node)
+{
+  NS_ABORT_MSG_IF (node >= m_selected.size (), "Node " << node << " out of range");
+  m_selected[node] = true;
+}
+
+void
+NodeCounterCalculator::SelectAll (void)
+{
+  m_selected.assign (m_selected.size (), true);
+}
+
+uint32_t
+NodeCounterCalculator::GetCount (uint32_t node) const
+{
+  return m_counts[node];
+}
+
+void
+NodeCounterCalculator::ConnectMac (NetDeviceContainer devices, std::string traceSource)
+{
+  for (NetDeviceContainer::Iterator it = devices.Begin (); it != devices.End (); ++it)
+    {
+      Ptr<WifiNetDevice> device = DynamicCast<WifiNetDevice> (*it);
+      if (device == 0)
+        {
+          continue;
+        }
+      uint32_t node = device->GetNode ()->GetId ();
+      NS_ABORT_MSG_IF (node >= m_counts.size (), "Node " << node << " out of range");
+      bool ok = device->GetMac ()->TraceConnectWithoutContext
+          (traceSource, MakeBoundCallback (&NodeCounterCalculator::Increment, &m_counts[node]));
+      NS_ABORT_MSG_IF (!ok, "WifiMac has no trace source " << traceSource);
+    }
+}
+
+void
+NodeCounterCalculator::Output (DataOutputCallback &callback) const
+{
+  for (uint32_t node = 0; node < m_counts.size (); ++node)
+    {
+      if (m_selected[node])
+        {
+          std::ostringstream context;
+          context << "node[" << node << "]";
+          callback.OutputSingleton (context.str (), m_key, m_counts[node]);
+        }
+    }
+}
+
+void
+NodeCounterCalculator::Increment (uint32_t *counter, Ptr<const Packet> packet)
+{
+  ++*counter;
+}
+
+} // namespace ns3
+
+#endif /* LY_NODE_TRACE_COUNTERS_H */
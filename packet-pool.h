@@ -0,0 +1,128 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Recycling of application packets.
+//
+// The UDP socket sends a copy of the application's packet, so once the
+// Tx trace sinks have returned only the application still holds it.
+// The pool keeps such packets and hands one back out, with its tags
+// removed, when a packet of the same size is asked for; the Packet
+// object and its zero-filled payload buffer are not allocated again.
+// Headers, tags and metadata added further down the stack belong to
+// the copy and are allocated as before.
+//
+// A recycled packet keeps its uid, so several frames in flight can
+// share one uid.  Statistics of this scenario match packets by port
+// and timestamp tag and are not affected, but uid-based tools
+// (NetAnim, ly2017210600TraceAnalyze) are; the pool is therefore off
+// unless asked for.
+//
+#ifndef LY_PACKET_POOL_H
+#define LY_PACKET_POOL_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "ns3/packet.h"
+#include "ns3/simple-ref-count.h"
+
+namespace ns3 {
+
+class PacketPool : public SimpleRefCount<PacketPool>
+{
+public:
+  /// \param capacity packets kept for reuse
+  explicit PacketPool (uint32_t capacity = 64);
+
+  /**
+   * \param size payload size
+   * \return a packet of that size without tags, recycled if possible
+   */
+  Ptr<Packet> Get (uint32_t size);
+
+  uint64_t GetHits (void) const;
+  uint64_t GetMisses (void) const;
+  /// \return fraction of Get() calls served from the pool
+  double GetHitRate (void) const;
+
+private:
+  std::vector<Ptr<Packet> > m_packets;
+  uint32_t m_capacity;
+  uint32_t m_cursor;    //!< where the next search starts
+  uint64_t m_hits;
+  uint64_t m_misses;
+};
+
+PacketPool::PacketPool (uint32_t capacity)
+  : m_capacity (capacity),
+    m_cursor (0),
+    m_hits (0),
+    m_misses (0)
+{
+  m_packets.reserve (capacity);
+}
+
+Ptr<Packet>
+PacketPool::Get (uint32_t size)
+{
+  uint32_t n = m_packets.size ();
+  for (uint32_t k = 0; k < n; ++k)
+    {
+      uint32_t i = (m_cursor + k) % n;
+      Ptr<Packet> &p = m_packets[i];
+      // 1 = only the pool still refers to it
+      if (p->GetReferenceCount () == 1 && p->GetSize () == size)
+        {
+          p->RemoveAllByteTags ();
+          p->RemoveAllPacketTags ();
+          m_cursor = (i + 1) % n;
+          ++m_hits;
+          return p;
+        }
+    }
+  ++m_misses;
+  Ptr<Packet> p = Create<Packet> (size);
+  if (m_packets.size () < m_capacity)
+    {
+      m_packets.push_back (p);
+    }
+  return p;
+}
+
+uint64_t
+PacketPool::GetHits (void) const
+{
+  return m_hits;
+}
+
+uint64_t
+PacketPool::GetMisses (void) const
+{
+  return m_misses;
+}
+
+double
+PacketPool::GetHitRate (void) const
+{
+  uint64_t total = m_hits + m_misses;
+  return total > 0 ? static_cast<double> (m_hits) / total : 0.0;
+}
+
+} // namespace ns3
+
+#endif /* LY_PACKET_POOL_H */
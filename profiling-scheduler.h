@@ -0,0 +1,401 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Event scheduler that attributes wall-clock time to event types.
+//
+// The default simulator takes an event with RemoveNext(), runs it and
+// comes back for the next one, so the wall time between two
+// RemoveNext() calls is the cost of the event handed out by the first
+// (its handler and everything it traces, logs and schedules).  The time
+// is charged to the event's dynamic type, the EventImpl that
+// MakeEvent() instantiates for the signature of the scheduled call, e.g.
+//
+//   ns3::MakeEvent<void (ns3::WifiPhy::*)(...), ns3::YansWifiPhy*, ...>::EventMemberImpl2
+//
+// The granularity is therefore the signature, not the target function:
+// all methods of one class with the same signature share an entry (e.g.
+// every void () timer of olsr::RoutingProtocol), every ns3::Timer
+// expiry lands under TimerImpl, and a static or free function is known
+// only by its parameter types, so GridYansWifiChannel::Receive shows up
+// as YansWifiPhy, its first argument.  Telling those apart would need
+// the target recorded at Schedule() time, which the simulator does not
+// offer to a scheduler.
+//
+// With Sample=N only every N-th event is looked up and timed, and its
+// type is credited with N events; unsampled events only bump a counter.
+// The events are kept by an inner scheduler (MapScheduler by default).
+//
+// Enable it before the first event is scheduled:
+//
+//   ObjectFactory factory;
+//   factory.SetTypeId ("ns3::ProfilingScheduler");
+//   Simulator::SetScheduler (factory);
+//   ...
+//   ProfilingScheduler::WriteFolded ("profile.folded");
+//   ProfilingScheduler::PrintTop (std::cout, 20);
+//
+// The folded file has one "Simulator::Run;<target>;<event type> <us>"
+// line per event type and is read by flamegraph.pl or speedscope.
+// <target> is the first ns-3 class the type names, as above.
+//
+#ifndef LY_PROFILING_SCHEDULER_H
+#define LY_PROFILING_SCHEDULER_H
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+#ifdef __GNUC__
+#include <cxxabi.h>
+#endif
+
+#include "ns3/abort.h"
+#include "ns3/event-impl.h"
+#include "ns3/object-factory.h"
+#include "ns3/scheduler.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+
+namespace ns3 {
+
+class ProfilingScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  ProfilingScheduler ();
+  virtual ~ProfilingScheduler ();
+
+  virtual void Insert (const Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Event PeekNext (void) const;
+  virtual Event RemoveNext (void);
+  virtual void Remove (const Event &ev);
+
+  /// \return events handed out so far by every ProfilingScheduler
+  static uint64_t GetEvents (void);
+  /**
+   * \param fileName folded-stack file to write
+   */
+  static void WriteFolded (std::string fileName);
+  /**
+   * \param os stream to print on
+   * \param n targets to list, by wall time
+   */
+  static void PrintTop (std::ostream &os, uint32_t n);
+
+private:
+  struct Entry
+  {
+    std::string name;      //!< demangled event type
+    uint64_t events;       //!< events of this type, estimated from the samples
+    uint64_t timed;        //!< events of this type that were timed
+    double seconds;        //!< wall time of the timed ones
+  };
+  typedef std::unordered_map<const std::type_info *, Entry> Table;
+  typedef std::chrono::steady_clock Clock;
+
+  static Table &GetTable (void);
+  static uint64_t &EventCount (void);
+  static std::string Demangle (const char *name);
+  static std::string Target (const std::string &name);
+  static std::vector<const Entry *> Sorted (void);
+
+  Scheduler *Inner (void) const;
+  void Stop (void);
+
+  std::string m_innerType;
+  uint32_t m_sample;
+  mutable Ptr<Scheduler> m_inner;
+  uint64_t m_count;
+  Entry *m_running;            //!< entry of the event being timed, 0 if none
+  Clock::time_point m_start;
+};
+
+TypeId
+ProfilingScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ProfilingScheduler")
+    .SetParent<Scheduler> ()
+    .SetGroupName ("Core")
+    .AddConstructor<ProfilingScheduler> ()
+    .AddAttribute ("Inner", "Scheduler that keeps the events.",
+                   StringValue ("ns3::MapScheduler"),
+                   MakeStringAccessor (&ProfilingScheduler::m_innerType),
+                   MakeStringChecker ())
+    .AddAttribute ("Sample", "Time one event in this many.",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&ProfilingScheduler::m_sample),
+                   MakeUintegerChecker<uint32_t> (1))
+  ;
+  return tid;
+}
+
+ProfilingScheduler::ProfilingScheduler ()
+  : m_sample (1),
+    m_count (0),
+    m_running (0)
+{
+}
+
+ProfilingScheduler::~ProfilingScheduler ()
+{
+  Stop ();
+}
+
+Scheduler *
+ProfilingScheduler::Inner (void) const
+{
+  if (m_inner == 0)
+    {
+      ObjectFactory factory;
+      factory.SetTypeId (m_innerType);
+      m_inner = factory.Create<Scheduler> ();
+      NS_ABORT_MSG_IF (m_inner == 0, m_innerType << " is not a Scheduler");
+    }
+  return PeekPointer (m_inner);
+}
+
+void
+ProfilingScheduler::Insert (const Event &ev)
+{
+  Inner ()->Insert (ev);
+}
+
+bool
+ProfilingScheduler::IsEmpty (void) const
+{
+  return Inner ()->IsEmpty ();
+}
+
+Scheduler::Event
+ProfilingScheduler::PeekNext (void) const
+{
+  return Inner ()->PeekNext ();
+}
+
+void
+ProfilingScheduler::Remove (const Event &ev)
+{
+  Inner ()->Remove (ev);
+}
+
+void
+ProfilingScheduler::Stop (void)
+{
+  if (m_running != 0)
+    {
+      m_running->seconds += std::chrono::duration<double> (Clock::now () - m_start).count ();
+      m_running = 0;
+    }
+}
+
+Scheduler::Event
+ProfilingScheduler::RemoveNext (void)
+{
+  // the previous event has run by now
+  Stop ();
+  Event ev = Inner ()->RemoveNext ();
+  ++EventCount ();
+  if (m_count++ % m_sample != 0)
+    {
+      return ev;
+    }
+  Table &table = GetTable ();
+  const std::type_info *type = &typeid (*ev.impl);
+  Table::iterator it = table.find (type);
+  if (it == table.end ())
+    {
+      Entry entry = { Demangle (type->name ()), 0, 0, 0.0 };
+      it = table.insert (std::make_pair (type, entry)).first;
+    }
+  // the sample stands for the m_sample events up to the next one
+  it->second.events += m_sample;
+  ++it->second.timed;
+  m_running = &it->second;
+  m_start = Clock::now ();
+  return ev;
+}
+
+ProfilingScheduler::Table &
+ProfilingScheduler::GetTable (void)
+{
+  static Table table;
+  return table;
+}
+
+uint64_t &
+ProfilingScheduler::EventCount (void)
+{
+  static uint64_t events = 0;
+  return events;
+}
+
+uint64_t
+ProfilingScheduler::GetEvents (void)
+{
+  return EventCount ();
+}
+
+std::string
+ProfilingScheduler::Demangle (const char *name)
+{
+#ifdef __GNUC__
+  int status = 0;
+  char *demangled = abi::__cxa_demangle (name, 0, 0, &status);
+  if (status == 0 && demangled != 0)
+    {
+      std::string result (demangled);
+      std::free (demangled);
+      return result;
+    }
+#endif
+  return name;
+}
+
+std::string
+ProfilingScheduler::Target (const std::string &name)
+{
+  // skip the MakeEvent wrapper and smart pointers, take the next name
+  static const char *skip[] = { "ns3::MakeEvent", "ns3::EventImpl", "ns3::Ptr<", "ns3::Callback" };
+  std::string::size_type pos = 0;
+  while ((pos = name.find ("ns3::", pos)) != std::string::npos)
+    {
+      bool skipped = false;
+      for (uint32_t k = 0; k < sizeof (skip) / sizeof (skip[0]); ++k)
+        {
+          if (name.compare (pos, std::string (skip[k]).size (), skip[k]) == 0)
+            {
+              skipped = true;
+            }
+        }
+      std::string::size_type end = pos + 5;
+      while (end < name.size () && (std::isalnum (name[end]) || name[end] == '_' || name[end] == ':'))
+        {
+          ++end;
+        }
+      if (!skipped)
+        {
+          std::string target = name.substr (pos, end - pos);
+          return target.substr (0, target.find_last_not_of (':') + 1);
+        }
+      pos = end;
+    }
+  return "other";
+}
+
+std::vector<const ProfilingScheduler::Entry *>
+ProfilingScheduler::Sorted (void)
+{
+  std::vector<const Entry *> entries;
+  Table &table = GetTable ();
+  for (Table::const_iterator it = table.begin (); it != table.end (); ++it)
+    {
+      entries.push_back (&it->second);
+    }
+  std::sort (entries.begin (), entries.end (), [] (const Entry *a, const Entry *b)
+    {
+      double sa = a->timed > 0 ? a->seconds * a->events / a->timed : 0;
+      double sb = b->timed > 0 ? b->seconds * b->events / b->timed : 0;
+      return sa > sb;
+    });
+  return entries;
+}
+
+void
+ProfilingScheduler::WriteFolded (std::string fileName)
+{
+  std::ofstream out (fileName.c_str ());
+  NS_ABORT_MSG_IF (!out, "Cannot write " << fileName);
+  std::vector<const Entry *> entries = Sorted ();
+  for (uint32_t i = 0; i < entries.size (); ++i)
+    {
+      const Entry *e = entries[i];
+      if (e->timed == 0)
+        {
+          continue;
+        }
+      uint64_t us = static_cast<uint64_t> (e->seconds * e->events / e->timed * 1e6 + 0.5);
+      out << "Simulator::Run;" << Target (e->name) << ";" << e->name << " " << us << "\n";
+    }
+}
+
+void
+ProfilingScheduler::PrintTop (std::ostream &os, uint32_t n)
+{
+  // event types with the same target are listed together
+  std::vector<const Entry *> entries = Sorted ();
+  std::vector<std::pair<double, std::string> > targets;
+  std::vector<uint64_t> events;
+  std::unordered_map<std::string, uint32_t> index;
+  double total = 0;
+  for (uint32_t i = 0; i < entries.size (); ++i)
+    {
+      const Entry *e = entries[i];
+      double seconds = e->timed > 0 ? e->seconds * e->events / e->timed : 0;
+      std::string target = Target (e->name);
+      std::pair<std::unordered_map<std::string, uint32_t>::iterator, bool> inserted =
+        index.insert (std::make_pair (target, static_cast<uint32_t> (targets.size ())));
+      if (inserted.second)
+        {
+          targets.push_back (std::make_pair (0.0, target));
+          events.push_back (0);
+        }
+      targets[inserted.first->second].first += seconds;
+      events[inserted.first->second] += e->events;
+      total += seconds;
+    }
+  std::vector<uint32_t> order (targets.size ());
+  for (uint32_t i = 0; i < order.size (); ++i)
+    {
+      order[i] = i;
+    }
+  std::sort (order.begin (), order.end (), [&targets] (uint32_t a, uint32_t b)
+    {
+      return targets[a].first > targets[b].first;
+    });
+
+  std::ios::fmtflags flags = os.flags ();
+  std::streamsize precision = os.precision ();
+  os << std::setw (12) << "events" << std::setw (12) << "wall s" << std::setw (8) << "%"
+     << std::setw (10) << "us/event" << "  target" << std::endl;
+  for (uint32_t k = 0; k < order.size () && k < n; ++k)
+    {
+      uint32_t i = order[k];
+      double seconds = targets[i].first;
+      os << std::setw (12) << events[i]
+         << std::setw (12) << std::fixed << std::setprecision (3) << seconds
+         << std::setw (8) << std::setprecision (1) << (total > 0 ? 100 * seconds / total : 0)
+         << std::setw (10) << std::setprecision (2) << (events[i] > 0 ? 1e6 * seconds / events[i] : 0)
+         << "  " << targets[i].second << std::endl;
+    }
+  os.flags (flags);
+  os.precision (precision);
+}
+
+} // namespace ns3
+
+#endif /* LY_PROFILING_SCHEDULER_H */
@@ -0,0 +1,213 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Synchronized sleep schedule for WiFi radios.
+//
+// Every period all radios wake together, stay awake for a fixed window
+// and go back to sleep, with WifiPhy::ResumeFromSleep() and
+// SetSleepMode().  One event wakes and one event puts to sleep every
+// radio, whatever the number of nodes.  A radio that is transmitting or
+// receiving when the window closes finishes first (SetSleepMode defers
+// itself).  While a radio sleeps the channel access manager holds its
+// queued frames, so they go out in the next window, when every other
+// radio listens too.  Install() raises the MaxDelay of the radios' MAC
+// queues (500 ms by default) to at least one period, so frames queued
+// while asleep are delayed, not dropped.
+//
+// OLSR's HELLO timer is jittered and runs independently of the window,
+// so a HELLO is usually generated while the radio sleeps and waits for
+// the next window.  With the period equal to the HelloInterval, each
+// node still sends about one HELLO per window, when every neighbor
+// listens.  The held frames of all nodes contend at the start of the
+// window, and a HELLO lost there is only repeated one period later, well
+// within the neighbor hold time (3 HelloIntervals).
+//
+// Both energy models charge sleep at the radio's SleepCurrentA.  A
+// sleeping radio still receives every frame from the channel and drops
+// it; GridYansWifiChannel::SetSkipAsleep() avoids those events on the
+// grid channel (see there for what that changes).
+//
+#ifndef LY_RADIO_DUTY_CYCLE_H
+#define LY_RADIO_DUTY_CYCLE_H
+
+#include <vector>
+
+#include "ns3/abort.h"
+#include "ns3/event-id.h"
+#include "ns3/net-device-container.h"
+#include "ns3/nstime.h"
+#include "ns3/pointer.h"
+#include "ns3/simulator.h"
+#include "ns3/txop.h"
+#include "ns3/wifi-mac.h"
+#include "ns3/wifi-mac-queue.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/wifi-phy.h"
+
+namespace ns3 {
+
+class RadioDutyCycle
+{
+public:
+  RadioDutyCycle ();
+  ~RadioDutyCycle ();
+
+  /**
+   * \param period time between two wake-ups
+   * \param awake part of the period the radios listen, in (0, 1]
+   */
+  void SetSchedule (Time period, double awake);
+  /**
+   * Put these radios on the schedule.  They are awake at start, go to
+   * sleep after the first window and wake again every period.
+   * \param devices WifiNetDevices
+   * \param start time of the first wake-up
+   */
+  void Install (NetDeviceContainer devices, Time start);
+  /// wake every radio and leave the schedule
+  void Stop (void);
+
+  /// \return wake-ups so far
+  uint64_t GetCycles (void) const;
+
+private:
+  void HoldQueuedFrames (Ptr<WifiMac> mac) const;
+  void Wake (void);
+  void Sleep (void);
+
+  Time m_period;
+  Time m_awake;
+  std::vector<Ptr<WifiPhy> > m_phys;
+  EventId m_event;
+  uint64_t m_cycles;
+};
+
+RadioDutyCycle::RadioDutyCycle ()
+  : m_period (Seconds (2.0)),
+    m_awake (Seconds (2.0)),
+    m_cycles (0)
+{
+}
+
+RadioDutyCycle::~RadioDutyCycle ()
+{
+  m_event.Cancel ();
+}
+
+void
+RadioDutyCycle::SetSchedule (Time period, double awake)
+{
+  NS_ABORT_MSG_IF (!period.IsStrictlyPositive (), "Duty cycle period must be positive");
+  NS_ABORT_MSG_IF (awake <= 0 || awake > 1, "Awake part of the period must be in (0, 1]");
+  m_period = period;
+  m_awake = Seconds (period.GetSeconds () * awake);
+}
+
+void
+RadioDutyCycle::Install (NetDeviceContainer devices, Time start)
+{
+  m_phys.clear ();
+  for (NetDeviceContainer::Iterator it = devices.Begin (); it != devices.End (); ++it)
+    {
+      Ptr<WifiNetDevice> device = DynamicCast<WifiNetDevice> (*it);
+      NS_ABORT_MSG_IF (device == 0, "RadioDutyCycle needs WifiNetDevices");
+      m_phys.push_back (device->GetPhy ());
+      if (m_awake < m_period)
+        {
+          HoldQueuedFrames (device->GetMac ());
+        }
+    }
+  m_event.Cancel ();
+  if (m_awake < m_period)
+    {
+      m_event = Simulator::Schedule (start - Simulator::Now (), &RadioDutyCycle::Wake, this);
+    }
+}
+
+void
+RadioDutyCycle::HoldQueuedFrames (Ptr<WifiMac> mac) const
+{
+  // the DCF queue of a non-QoS MAC, or the four EDCA queues
+  static const char *txops[] = { "Txop", "VO_Txop", "VI_Txop", "BE_Txop", "BK_Txop" };
+  for (uint32_t k = 0; k < sizeof (txops) / sizeof (txops[0]); ++k)
+    {
+      PointerValue value;
+      if (!mac->GetAttributeFailSafe (txops[k], value) || value.Get<Txop> () == 0)
+        {
+          continue;
+        }
+      Ptr<WifiMacQueue> queue = value.Get<Txop> ()->GetWifiMacQueue ();
+      if (queue->GetMaxDelay () < m_period)
+        {
+          queue->SetMaxDelay (m_period);
+        }
+    }
+}
+
+void
+RadioDutyCycle::Stop (void)
+{
+  if (m_event.IsRunning ())
+    {
+      m_event.Cancel ();
+      for (uint32_t i = 0; i < m_phys.size (); ++i)
+        {
+          if (m_phys[i]->IsStateSleep ())
+            {
+              m_phys[i]->ResumeFromSleep ();
+            }
+        }
+    }
+}
+
+uint64_t
+RadioDutyCycle::GetCycles (void) const
+{
+  return m_cycles;
+}
+
+void
+RadioDutyCycle::Wake (void)
+{
+  for (uint32_t i = 0; i < m_phys.size (); ++i)
+    {
+      if (m_phys[i]->IsStateSleep ())
+        {
+          m_phys[i]->ResumeFromSleep ();
+        }
+    }
+  ++m_cycles;
+  m_event = Simulator::Schedule (m_awake, &RadioDutyCycle::Sleep, this);
+}
+
+void
+RadioDutyCycle::Sleep (void)
+{
+  for (uint32_t i = 0; i < m_phys.size (); ++i)
+    {
+      if (!m_phys[i]->IsStateOff ())  // depleted radios stay off
+        {
+          m_phys[i]->SetSleepMode ();
+        }
+    }
+  m_event = Simulator::Schedule (m_period - m_awake, &RadioDutyCycle::Wake, this);
+}
+
+} // namespace ns3
+
+#endif /* LY_RADIO_DUTY_CYCLE_H */
@@ -0,0 +1,331 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Radio energy of every node split by PHY state and by traffic role.
+//
+// The state split is read from a LazyRadioEnergy account: the time in
+// each state times its current and the supply voltage.
+//
+// The role split charges every TX and RX period to the frame that
+// caused it.  PhyTxBegin and PhyRxBegin name the frame just before the
+// state helper logs the period, and the frame is classified once:
+//
+//   source  data of a flow sent by the node that originated it
+//   relay   data of a flow forwarded by the node, or received to be
+//           forwarded
+//   sink    data of a flow received by its destination
+//   other   routing messages, ACKs, overheard frames, and periods
+//           whose frame was never seen (e.g. a failed preamble)
+//
+// Data frames are IPv4/UDP to one of the flow ports.  Idle, CCA busy
+// and sleep time belong to no frame and only appear in the state split.
+// Energies are kept as one array per state or role (struct of arrays).
+//
+// Output() writes "node[N] <key>-<state or role> J" singletons for every
+// node, next to the wifi-tx-frames and wifi-rx-frames counters.
+//
+#ifndef LY_RADIO_ENERGY_BREAKDOWN_H
+#define LY_RADIO_ENERGY_BREAKDOWN_H
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/abort.h"
+#include "ns3/callback.h"
+#include "ns3/ipv4.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/llc-snap-header.h"
+#include "ns3/mac48-address.h"
+#include "ns3/net-device-container.h"
+#include "ns3/packet.h"
+#include "ns3/pointer.h"
+#include "ns3/stats-module.h"
+#include "ns3/udp-header.h"
+#include "ns3/udp-l4-protocol.h"
+#include "ns3/wifi-mac-header.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/wifi-phy.h"
+#include "ns3/wifi-phy-state-helper.h"
+
+#include "lazy-radio-energy.h"
+
+namespace ns3 {
+
+class RadioEnergyBreakdown : public DataCalculator
+{
+public:
+  enum Role
+  {
+    SOURCE,
+    RELAY,
+    SINK,
+    OTHER,
+    ROLES
+  };
+
+  static TypeId GetTypeId (void);
+
+  RadioEnergyBreakdown ();
+  virtual ~RadioEnergyBreakdown ();
+
+  /**
+   * \param first lowest UDP destination port of flow data
+   * \param last highest one
+   */
+  void SetDataPorts (uint16_t first, uint16_t last);
+  /**
+   * Split the energy of the account's radios from now on.  The devices
+   * must have their IPv4 addresses.
+   * \param account the state times and currents of the radios
+   */
+  void Install (Ptr<LazyRadioEnergy> account);
+
+  /// \return J radio i spent on frames of the role so far
+  double GetRoleEnergy (uint32_t i, Role role) const;
+  /// \return J radio i spent in state so far
+  double GetStateEnergy (uint32_t i, WifiPhyState state) const;
+
+  virtual void Output (DataOutputCallback &callback) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  static void TxBegin (RadioEnergyBreakdown *breakdown, uint32_t i,
+                       Ptr<const Packet> packet, double txPowerW);
+  static void RxBegin (RadioEnergyBreakdown *breakdown, uint32_t i, Ptr<const Packet> packet);
+  static void StateLogged (RadioEnergyBreakdown *breakdown, uint32_t i,
+                           Time start, Time duration, WifiPhyState state);
+  Role Classify (uint32_t i, Ptr<const Packet> packet, bool tx) const;
+
+  static const char *RoleName (Role role);
+  static const char *StateName (WifiPhyState state);
+
+  Ptr<LazyRadioEnergy> m_account;
+  uint16_t m_firstPort;
+  uint16_t m_lastPort;
+  std::vector<uint32_t> m_nodeIds;
+  std::vector<Mac48Address> m_mac;
+  std::vector<Ipv4Address> m_ip;
+  std::vector<uint8_t> m_txRole;       //!< role of the frame being sent
+  std::vector<uint8_t> m_rxRole;       //!< role of the frame being received
+  std::vector<double> m_energy[ROLES]; //!< J per role, one array per role
+};
+
+TypeId
+RadioEnergyBreakdown::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::RadioEnergyBreakdown")
+    .SetParent<DataCalculator> ()
+    .SetGroupName ("Stats")
+    .AddConstructor<RadioEnergyBreakdown> ()
+  ;
+  return tid;
+}
+
+RadioEnergyBreakdown::RadioEnergyBreakdown ()
+  : m_firstPort (1),
+    m_lastPort (0)
+{
+}
+
+RadioEnergyBreakdown::~RadioEnergyBreakdown ()
+{
+}
+
+void
+RadioEnergyBreakdown::DoDispose (void)
+{
+  m_account = 0;
+  DataCalculator::DoDispose ();
+}
+
+void
+RadioEnergyBreakdown::SetDataPorts (uint16_t first, uint16_t last)
+{
+  m_firstPort = first;
+  m_lastPort = last;
+}
+
+void
+RadioEnergyBreakdown::Install (Ptr<LazyRadioEnergy> account)
+{
+  m_account = account;
+  uint32_t n = account->GetN ();
+  m_nodeIds.clear ();
+  m_mac.clear ();
+  m_ip.clear ();
+  m_txRole.assign (n, OTHER);
+  m_rxRole.assign (n, OTHER);
+  for (uint32_t r = 0; r < ROLES; ++r)
+    {
+      m_energy[r].assign (n, 0.0);
+    }
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      Ptr<WifiPhy> phy = account->GetPhy (i);
+      Ptr<NetDevice> device = phy->GetDevice ();
+      Ptr<Node> node = device->GetNode ();
+      Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+      NS_ABORT_MSG_IF (ipv4 == 0, "Node " << node->GetId () << " has no IPv4 address yet");
+      int32_t interface = ipv4->GetInterfaceForDevice (device);
+      NS_ABORT_MSG_IF (interface < 0, "Device of node " << node->GetId () << " has no IPv4 interface");
+      m_nodeIds.push_back (node->GetId ());
+      m_mac.push_back (Mac48Address::ConvertFrom (device->GetAddress ()));
+      m_ip.push_back (ipv4->GetAddress (interface, 0).GetLocal ());
+
+      phy->TraceConnectWithoutContext
+        ("PhyTxBegin", MakeBoundCallback (&RadioEnergyBreakdown::TxBegin, this, i));
+      phy->TraceConnectWithoutContext
+        ("PhyRxBegin", MakeBoundCallback (&RadioEnergyBreakdown::RxBegin, this, i));
+      PointerValue state;
+      phy->GetAttribute ("State", state);
+      state.Get<WifiPhyStateHelper> ()->TraceConnectWithoutContext
+        ("State", MakeBoundCallback (&RadioEnergyBreakdown::StateLogged, this, i));
+    }
+}
+
+RadioEnergyBreakdown::Role
+RadioEnergyBreakdown::Classify (uint32_t i, Ptr<const Packet> packet, bool tx) const
+{
+  Ptr<Packet> copy = packet->Copy ();
+  WifiMacHeader mac;
+  if (copy->RemoveHeader (mac) == 0 || !mac.IsData ())
+    {
+      return OTHER;
+    }
+  if (!tx && mac.GetAddr1 () != m_mac[i])
+    {
+      return OTHER;    // overheard
+    }
+  LlcSnapHeader llc;
+  if (copy->RemoveHeader (llc) == 0 || llc.GetType () != 0x0800)
+    {
+      return OTHER;
+    }
+  Ipv4Header ip;
+  copy->RemoveHeader (ip);
+  if (ip.GetProtocol () != UdpL4Protocol::PROT_NUMBER || ip.GetFragmentOffset () != 0)
+    {
+      return OTHER;
+    }
+  UdpHeader udp;
+  copy->PeekHeader (udp);
+  if (udp.GetDestinationPort () < m_firstPort || udp.GetDestinationPort () > m_lastPort)
+    {
+      return OTHER;
+    }
+  if (tx)
+    {
+      return ip.GetSource () == m_ip[i] ? SOURCE : RELAY;
+    }
+  return ip.GetDestination () == m_ip[i] ? SINK : RELAY;
+}
+
+void
+RadioEnergyBreakdown::TxBegin (RadioEnergyBreakdown *breakdown, uint32_t i,
+                               Ptr<const Packet> packet, double txPowerW)
+{
+  breakdown->m_txRole[i] = breakdown->Classify (i, packet, true);
+}
+
+void
+RadioEnergyBreakdown::RxBegin (RadioEnergyBreakdown *breakdown, uint32_t i, Ptr<const Packet> packet)
+{
+  breakdown->m_rxRole[i] = breakdown->Classify (i, packet, false);
+}
+
+void
+RadioEnergyBreakdown::StateLogged (RadioEnergyBreakdown *breakdown, uint32_t i,
+                                   Time start, Time duration, WifiPhyState state)
+{
+  std::vector<uint8_t> *pending;
+  if (state == TX)
+    {
+      pending = &breakdown->m_txRole;
+    }
+  else if (state == RX)
+    {
+      pending = &breakdown->m_rxRole;
+    }
+  else
+    {
+      return;
+    }
+  Ptr<LazyRadioEnergy> account = breakdown->m_account;
+  double joules = account->GetVoltage () * account->GetCurrent (state) * duration.GetSeconds ();
+  breakdown->m_energy[(*pending)[i]][i] += joules;
+  (*pending)[i] = OTHER;
+}
+
+double
+RadioEnergyBreakdown::GetRoleEnergy (uint32_t i, Role role) const
+{
+  return m_energy[role][i];
+}
+
+double
+RadioEnergyBreakdown::GetStateEnergy (uint32_t i, WifiPhyState state) const
+{
+  return m_account->GetVoltage () * m_account->GetCurrent (state) * m_account->GetStateTime (i, state);
+}
+
+const char *
+RadioEnergyBreakdown::RoleName (Role role)
+{
+  static const char *names[] = { "source", "relay", "sink", "other" };
+  return names[role];
+}
+
+const char *
+RadioEnergyBreakdown::StateName (WifiPhyState state)
+{
+  static const char *names[] = { "idle", "cca-busy", "tx", "rx", "switching", "sleep", "off" };
+  return state < sizeof (names) / sizeof (names[0]) ? names[state] : "unknown";
+}
+
+void
+RadioEnergyBreakdown::Output (DataOutputCallback &callback) const
+{
+  if (m_account == 0)
+    {
+      return;
+    }
+  for (uint32_t i = 0; i < m_nodeIds.size (); ++i)
+    {
+      std::ostringstream context;
+      context << "node[" << m_nodeIds[i] << "]";
+      for (uint32_t s = IDLE; s <= SLEEP; ++s)
+        {
+          WifiPhyState state = static_cast<WifiPhyState> (s);
+          callback.OutputSingleton (context.str (), m_key + "-" + StateName (state),
+                                    GetStateEnergy (i, state));
+        }
+      for (uint32_t r = 0; r < ROLES; ++r)
+        {
+          Role role = static_cast<Role> (r);
+          callback.OutputSingleton (context.str (), m_key + "-" + RoleName (role),
+                                    GetRoleEnergy (i, role));
+        }
+    }
+}
+
+} // namespace ns3
+
+#endif /* LY_RADIO_ENERGY_BREAKDOWN_H */
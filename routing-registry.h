@@ -0,0 +1,186 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Routing protocols selectable by name.
+//
+// The registry keeps one configured routing helper per name and builds
+// the list routing the scenarios install: static routing at priority 0
+// and the selected protocol at priority 10, as the scenarios always
+// did for OLSR.  olsr, aodv, dsdv and static (precomputed min-hop
+// routes without control traffic, see next-hop-matrix-routing.h) are
+// registered by default, and "wifi-default", the scenario's historic
+// strategy label, means olsr.
+//
+// Routing tables and neighbor caches are printed through the static
+// Ipv4RoutingHelper functions, which ask whatever protocol the node
+// runs, so the dumps follow the selection.
+//
+#ifndef LY_ROUTING_REGISTRY_H
+#define LY_ROUTING_REGISTRY_H
+
+#include <map>
+#include <sstream>
+#include <string>
+
+#include "ns3/abort.h"
+#include "ns3/ipv4-routing-helper.h"
+#include "ns3/ipv4-list-routing-helper.h"
+#include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/olsr-helper.h"
+#include "ns3/aodv-helper.h"
+#include "ns3/dsdv-helper.h"
+
+#include "next-hop-matrix-routing.h"
+
+namespace ns3 {
+
+class RoutingRegistry
+{
+public:
+  /// registers olsr, aodv, dsdv and static with their default attributes
+  RoutingRegistry ();
+  ~RoutingRegistry ();
+
+  /**
+   * \param name strategy name
+   * \param helper configured helper; the registry keeps a copy
+   */
+  void Add (std::string name, const Ipv4RoutingHelper &helper);
+  /// \param alias another name for the strategy called name
+  void AddAlias (std::string alias, std::string name);
+  /// \param name strategy to withdraw, with its aliases
+  void Remove (std::string name);
+  bool Has (std::string name) const;
+  /// \return the registered names, comma-separated
+  std::string GetNames (void) const;
+
+  /**
+   * \param name strategy name; aborts if unknown
+   * \return static routing plus the named protocol
+   */
+  Ipv4ListRoutingHelper GetListRouting (std::string name) const;
+
+private:
+  RoutingRegistry (const RoutingRegistry &);
+  RoutingRegistry &operator= (const RoutingRegistry &);
+
+  std::string Resolve (std::string name) const;
+
+  std::map<std::string, Ipv4RoutingHelper *> m_helpers;
+  std::map<std::string, std::string> m_aliases;
+};
+
+RoutingRegistry::RoutingRegistry ()
+{
+  Add ("olsr", OlsrHelper ());
+  Add ("aodv", AodvHelper ());
+  Add ("dsdv", DsdvHelper ());
+  Add ("static", NextHopMatrixRoutingHelper ());
+  AddAlias ("wifi-default", "olsr");
+}
+
+RoutingRegistry::~RoutingRegistry ()
+{
+  for (std::map<std::string, Ipv4RoutingHelper *>::iterator it = m_helpers.begin ();
+       it != m_helpers.end (); ++it)
+    {
+      delete it->second;
+    }
+}
+
+void
+RoutingRegistry::Add (std::string name, const Ipv4RoutingHelper &helper)
+{
+  std::map<std::string, Ipv4RoutingHelper *>::iterator it = m_helpers.find (name);
+  if (it != m_helpers.end ())
+    {
+      delete it->second;
+    }
+  m_helpers[name] = helper.Copy ();
+}
+
+void
+RoutingRegistry::AddAlias (std::string alias, std::string name)
+{
+  m_aliases[alias] = name;
+}
+
+void
+RoutingRegistry::Remove (std::string name)
+{
+  std::map<std::string, Ipv4RoutingHelper *>::iterator it = m_helpers.find (name);
+  if (it != m_helpers.end ())
+    {
+      delete it->second;
+      m_helpers.erase (it);
+    }
+  for (std::map<std::string, std::string>::iterator alias = m_aliases.begin ();
+       alias != m_aliases.end (); )
+    {
+      if (alias->second == name)
+        {
+          m_aliases.erase (alias++);
+        }
+      else
+        {
+          ++alias;
+        }
+    }
+}
+
+std::string
+RoutingRegistry::Resolve (std::string name) const
+{
+  std::map<std::string, std::string>::const_iterator it = m_aliases.find (name);
+  return it != m_aliases.end () ? it->second : name;
+}
+
+bool
+RoutingRegistry::Has (std::string name) const
+{
+  return m_helpers.find (Resolve (name)) != m_helpers.end ();
+}
+
+std::string
+RoutingRegistry::GetNames (void) const
+{
+  std::ostringstream names;
+  for (std::map<std::string, Ipv4RoutingHelper *>::const_iterator it = m_helpers.begin ();
+       it != m_helpers.end (); ++it)
+    {
+      names << (it == m_helpers.begin () ? "" : ",") << it->first;
+    }
+  return names.str ();
+}
+
+Ipv4ListRoutingHelper
+RoutingRegistry::GetListRouting (std::string name) const
+{
+  std::map<std::string, Ipv4RoutingHelper *>::const_iterator it = m_helpers.find (Resolve (name));
+  NS_ABORT_MSG_IF (it == m_helpers.end (),
+                   "Unknown routing strategy " << name << "; known: " << GetNames ());
+  Ipv4StaticRoutingHelper staticRouting;
+  Ipv4ListRoutingHelper list;
+  list.Add (staticRouting, 0);
+  list.Add (*it->second, 10);
+  return list;
+}
+
+} // namespace ns3
+
+#endif /* LY_ROUTING_REGISTRY_H */
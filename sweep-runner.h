@@ -0,0 +1,479 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Parameter sweep runner for the adhoc grid scenario.
+//
+// A sweep is a grid of command-line values (one axis per option, e.g.
+// "distance=500,1000;strategy=olsr,aodv") crossed with a number of
+// replications.  Every point of the grid is run as an independent worker
+// process (the same binary, re-executed with the point's options), at
+// most "jobs" of them at a time.
+//
+// Each job gets a deterministic run label built from its axis values and
+// replication index, and RngRun = baseRun + replication, so the same
+// replication uses the same random stream at every sweep point.  The
+// label also names the job's files, so characters of the values other
+// than letters, digits and "+,-._" are written as %XX.
+//
+// Finished jobs are appended to one merged output file: omnet .sca, or
+// columnar .lycol chunks when the output name ends in ".lycol"; the
+// workers are run with the matching --format, and with --jobs=1 so a
+// worker with --warmup runs its forks one at a time.  A journal
+// next to it ("<output>.done") records, for every merged job, its run
+// label and the merged file size after the append.  On restart the
+// merged file is truncated to the last journaled size (dropping a
+// half-written append) and journaled jobs are skipped, so a crashed
+// sweep resumes where it stopped.
+//
+#ifndef LY_SWEEP_RUNNER_H
+#define LY_SWEEP_RUNNER_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <cerrno>
+#include <cctype>
+#include <cstring>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "ns3/log.h"
+#include "ns3/abort.h"
+
+namespace ns3 {
+
+/**
+ * One point of the sweep grid with one replication seed.
+ */
+struct SweepJob
+{
+  std::vector<std::pair<std::string, std::string> > options; //!< axis name/value pairs
+  uint32_t replication;                                      //!< replication index
+  uint32_t rngRun;                                           //!< value passed as --RngRun
+  std::string runId;                                         //!< deterministic run label
+  std::string prefix;                                        //!< per-job output file prefix
+};
+
+/**
+ * Runs every point of a parameter grid as a separate worker process and
+ * merges their omnet output.
+ */
+class SweepRunner
+{
+public:
+  SweepRunner ();
+
+  /**
+   * Parse a sweep specification of the form
+   * "name=v1,v2,...;name2=w1,w2,...".  Each name must be a command-line
+   * option of the scenario.
+   *
+   * \param spec the sweep specification
+   */
+  void SetGrid (std::string spec);
+  void SetReplications (uint32_t replications);
+  void SetBaseRun (uint32_t baseRun);
+  /**
+   * \param jobs maximum number of concurrent workers; 0 means one per
+   *        online processor
+   */
+  void SetJobs (uint32_t jobs);
+  /**
+   * \param output path of the merged .sca or .lycol file; per-job
+   *        files go to "<output>.d/"
+   */
+  void SetOutput (std::string output);
+  /// \return the --format the workers write: columnar for .lycol, else omnet
+  std::string GetFormat (void) const;
+
+  /**
+   * Expand the grid into the list of jobs, in a stable order.
+   * \return the jobs
+   */
+  std::vector<SweepJob> GetJobs (void) const;
+
+  /**
+   * Run all jobs that are not yet recorded in the journal.
+   *
+   * \param argc the scenario's argc
+   * \param argv the scenario's argv; sweep options are stripped before
+   *        they are handed to the workers, and a --format other than
+   *        GetFormat () aborts
+   * \return 0 if every job succeeded, 1 otherwise
+   */
+  int Run (int argc, char *argv[]);
+
+  /**
+   * \param arg a command-line argument
+   * \return true if it only concerns the sweep parent
+   */
+  static bool IsSweepArgument (std::string arg);
+
+private:
+  static std::string Escape (std::string value);
+  std::set<std::string> ReadJournal (void);
+  pid_t Spawn (const SweepJob &job, const std::vector<std::string> &base) const;
+  bool Merge (const SweepJob &job);
+
+  std::vector<std::pair<std::string, std::vector<std::string> > > m_axes;
+  uint32_t m_replications;
+  uint32_t m_baseRun;
+  uint32_t m_jobs;
+  std::string m_output;
+};
+
+SweepRunner::SweepRunner ()
+  : m_replications (1),
+    m_baseRun (1),
+    m_jobs (0),
+    m_output ("sweep.sca")
+{
+}
+
+void
+SweepRunner::SetGrid (std::string spec)
+{
+  m_axes.clear ();
+  std::istringstream axes (spec);
+  std::string axis;
+  while (std::getline (axes, axis, ';'))
+    {
+      if (axis.empty ())
+        {
+          continue;
+        }
+      std::string::size_type eq = axis.find ('=');
+      NS_ABORT_MSG_IF (eq == std::string::npos || eq == 0,
+                       "Malformed sweep axis \"" << axis << "\", expected name=v1,v2,...");
+      std::vector<std::string> values;
+      std::istringstream list (axis.substr (eq + 1));
+      std::string value;
+      while (std::getline (list, value, ','))
+        {
+          if (!value.empty ())
+            {
+              values.push_back (value);
+            }
+        }
+      NS_ABORT_MSG_IF (values.empty (), "Sweep axis \"" << axis << "\" has no values");
+      m_axes.push_back (std::make_pair (axis.substr (0, eq), values));
+    }
+}
+
+void
+SweepRunner::SetReplications (uint32_t replications)
+{
+  m_replications = replications;
+}
+
+void
+SweepRunner::SetBaseRun (uint32_t baseRun)
+{
+  m_baseRun = baseRun;
+}
+
+void
+SweepRunner::SetJobs (uint32_t jobs)
+{
+  m_jobs = jobs;
+}
+
+void
+SweepRunner::SetOutput (std::string output)
+{
+  m_output = output;
+}
+
+std::string
+SweepRunner::GetFormat (void) const
+{
+  bool columnar = m_output.size () > 6
+    && m_output.compare (m_output.size () - 6, 6, ".lycol") == 0;
+  return columnar ? "columnar" : "omnet";
+}
+
+bool
+SweepRunner::IsSweepArgument (std::string arg)
+{
+  static const char *names[] = { "--sweep", "--sweepOutput", "--replications", "--jobs" };
+  for (uint32_t i = 0; i < sizeof (names) / sizeof (names[0]); ++i)
+    {
+      std::string name (names[i]);
+      if (arg == name || arg.compare (0, name.size () + 1, name + "=") == 0)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+std::string
+SweepRunner::Escape (std::string value)
+{
+  static const char *hex = "0123456789ABCDEF";
+  std::string escaped;
+  for (uint32_t i = 0; i < value.size (); ++i)
+    {
+      unsigned char c = value[i];
+      if (std::isalnum (c) || std::strchr ("+,-._", c) != 0)
+        {
+          escaped += c;
+        }
+      else
+        {
+          // '/' would leave "<output>.d/", blanks would split the journal
+          escaped += '%';
+          escaped += hex[c >> 4];
+          escaped += hex[c & 0xf];
+        }
+    }
+  return escaped;
+}
+
+std::vector<SweepJob>
+SweepRunner::GetJobs (void) const
+{
+  std::vector<SweepJob> jobs;
+  uint32_t points = 1;
+  for (uint32_t a = 0; a < m_axes.size (); ++a)
+    {
+      points *= m_axes[a].second.size ();
+    }
+  for (uint32_t p = 0; p < points; ++p)
+    {
+      // mixed-radix decode of the point index, last axis varying fastest
+      std::vector<std::pair<std::string, std::string> > options (m_axes.size ());
+      uint32_t rest = p;
+      for (uint32_t a = m_axes.size (); a-- > 0; )
+        {
+          const std::vector<std::string> &values = m_axes[a].second;
+          options[a] = std::make_pair (m_axes[a].first, values[rest % values.size ()]);
+          rest /= values.size ();
+        }
+      for (uint32_t r = 0; r < m_replications; ++r)
+        {
+          SweepJob job;
+          job.options = options;
+          job.replication = r;
+          job.rngRun = m_baseRun + r;
+          std::ostringstream id;
+          id << "run";
+          for (uint32_t a = 0; a < options.size (); ++a)
+            {
+              id << "-" << Escape (options[a].first) << "=" << Escape (options[a].second);
+            }
+          id << "-r" << job.rngRun;
+          job.runId = id.str ();
+          job.prefix = m_output + ".d/" + job.runId;
+          jobs.push_back (job);
+        }
+    }
+  return jobs;
+}
+
+std::set<std::string>
+SweepRunner::ReadJournal (void)
+{
+  std::set<std::string> done;
+  std::ifstream journal ((m_output + ".done").c_str ());
+  std::string runId;
+  off_t size = 0;
+  off_t lastSize = 0;
+  while (journal >> runId >> size)
+    {
+      done.insert (runId);
+      lastSize = size;
+    }
+  // Drop whatever a crashed parent appended after its last journal entry.
+  if (truncate (m_output.c_str (), lastSize) != 0 && errno != ENOENT)
+    {
+      NS_LOG_UNCOND ("Sweep: could not truncate " << m_output << ": " << std::strerror (errno));
+    }
+  return done;
+}
+
+pid_t
+SweepRunner::Spawn (const SweepJob &job, const std::vector<std::string> &base) const
+{
+  std::vector<std::string> args (base);
+  for (uint32_t a = 0; a < job.options.size (); ++a)
+    {
+      args.push_back ("--" + job.options[a].first + "=" + job.options[a].second);
+    }
+  std::ostringstream rng;
+  rng << "--RngRun=" << job.rngRun;
+  args.push_back (rng.str ());
+  args.push_back ("--run=" + job.runId);
+  args.push_back ("--prefix=" + job.prefix);
+  args.push_back ("--format=" + GetFormat ());
+  // The sweep already runs "jobs" workers; a worker forking warm-up
+  // replications must not start one child per core on top of that.
+  args.push_back ("--jobs=1");
+  // Workers would all write the same animation file otherwise.
+  args.push_back ("--anim=0");
+
+  pid_t pid = fork ();
+  NS_ABORT_MSG_IF (pid < 0, "fork failed: " << std::strerror (errno));
+  if (pid == 0)
+    {
+      int log = open ((job.prefix + ".log").c_str (), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (log >= 0)
+        {
+          dup2 (log, STDOUT_FILENO);
+          dup2 (log, STDERR_FILENO);
+          close (log);
+        }
+      std::vector<char *> argv;
+      for (uint32_t i = 0; i < args.size (); ++i)
+        {
+          argv.push_back (const_cast<char *> (args[i].c_str ()));
+        }
+      argv.push_back (0);
+      execv ("/proc/self/exe", &argv[0]);
+      execvp (argv[0], &argv[0]);
+      _exit (127);
+    }
+  return pid;
+}
+
+bool
+SweepRunner::Merge (const SweepJob &job)
+{
+  // columnar chunks are self-delimiting and are appended as they are
+  bool columnar = GetFormat () == "columnar";
+  std::string name = job.prefix + (columnar ? ".lycol" : ".sca");
+  std::ifstream in (name.c_str (), std::ios::binary);
+  if (!in)
+    {
+      NS_LOG_UNCOND ("Sweep: job " << job.runId << " produced no " << name);
+      return false;
+    }
+  std::ofstream out (m_output.c_str (), std::ios::binary | std::ios::app);
+  out << in.rdbuf ();
+  if (!columnar)
+    {
+      out << "\n";
+    }
+  out.close ();
+  if (!out)
+    {
+      NS_LOG_UNCOND ("Sweep: could not append " << job.runId << " to " << m_output);
+      return false;
+    }
+
+  struct stat st;
+  NS_ABORT_MSG_IF (stat (m_output.c_str (), &st) != 0,
+                   "Could not stat " << m_output);
+  std::ofstream journal ((m_output + ".done").c_str (), std::ios::app);
+  journal << job.runId << " " << st.st_size << std::endl;
+  return true;
+}
+
+int
+SweepRunner::Run (int argc, char *argv[])
+{
+  std::vector<std::string> base;
+  base.push_back (argv[0]);
+  for (int i = 1; i < argc; ++i)
+    {
+      std::string arg (argv[i]);
+      if (arg.compare (0, 9, "--format=") == 0)
+        {
+          // Spawn passes the format the merge expects
+          NS_ABORT_MSG_IF (arg.substr (9) != GetFormat (),
+                           arg << " does not match --sweepOutput=" << m_output
+                               << ", which takes --format=" << GetFormat ());
+          continue;
+        }
+      if (!IsSweepArgument (arg))
+        {
+          base.push_back (arg);
+        }
+    }
+
+  uint32_t jobs = m_jobs;
+  if (jobs == 0)
+    {
+      long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+      jobs = cpus > 0 ? cpus : 1;
+    }
+  mkdir ((m_output + ".d").c_str (), 0755);
+
+  std::set<std::string> done = ReadJournal ();
+  std::vector<SweepJob> all = GetJobs ();
+  std::vector<SweepJob> pending;
+  for (uint32_t j = 0; j < all.size (); ++j)
+    {
+      if (done.find (all[j].runId) == done.end ())
+        {
+          pending.push_back (all[j]);
+        }
+    }
+  NS_LOG_UNCOND ("Sweep: " << all.size () << " jobs, " << (all.size () - pending.size ())
+                           << " already done, " << jobs << " workers");
+
+  std::map<pid_t, SweepJob> running;
+  uint32_t next = 0;
+  uint32_t failed = 0;
+  while (next < pending.size () || !running.empty ())
+    {
+      while (next < pending.size () && running.size () < jobs)
+        {
+          pid_t pid = Spawn (pending[next], base);
+          running[pid] = pending[next];
+          ++next;
+        }
+      int status;
+      pid_t pid = waitpid (-1, &status, 0);
+      if (pid < 0)
+        {
+          NS_ABORT_MSG_IF (errno != EINTR, "waitpid failed: " << std::strerror (errno));
+          continue;
+        }
+      std::map<pid_t, SweepJob>::iterator it = running.find (pid);
+      if (it == running.end ())
+        {
+          continue;
+        }
+      SweepJob job = it->second;
+      running.erase (it);
+      if (WIFEXITED (status) && WEXITSTATUS (status) == 0 && Merge (job))
+        {
+          NS_LOG_UNCOND ("Sweep: finished " << job.runId);
+        }
+      else
+        {
+          ++failed;
+          NS_LOG_UNCOND ("Sweep: " << job.runId << " failed, see " << job.prefix << ".log");
+        }
+    }
+  NS_LOG_UNCOND ("Sweep: results in " << m_output << ", " << failed << " failed jobs");
+  return failed == 0 ? 0 : 1;
+}
+
+} // namespace ns3
+
+#endif /* LY_SWEEP_RUNNER_H */
@@ -0,0 +1,598 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// UDP sender driven by a traffic generator.
+//
+// A TrafficGenerator fills a batch of arrivals (time since the start,
+// packet size) at once, and TrafficSender keeps that batch; the
+// generator is only called when the batch is used up.
+//
+// The senders of a flow table share one TrafficDispatcher: a heap of
+// every sender's next arrival and a single pending simulator event, at
+// the earliest of them.  When it fires, every sender that is due sends
+// all of its due arrivals and files its next one.  Flows whose arrivals
+// coincide (cbr flows with the same interval and start) thus share one
+// event per instant, and the simulator queue holds one event for all
+// flows instead of one per flow; flows with their own arrival times
+// (poisson, onoff) still take one event per distinct instant, but the
+// heap replaces the simulator's insert and cancel.  The sends run in
+// the context of the dispatcher's event, not the sender's node, which
+// only shows in log prefixes.  Without a dispatcher a sender schedules
+// its own event per arrival.  Packets carry the same
+// TimestampTag and fire the same "Tx" trace as Sender, so Receiver and
+// the flow statistics work unchanged.  With a PacketPool the packets
+// are recycled instead of allocated (see packet-pool.h).
+//
+// Generators, as given by CreateTrafficGenerator():
+//
+//   cbr                  one packet every interval
+//   poisson              exponential gaps with mean interval
+//   onoff:<on>:<off>     exponential on and off periods (mean seconds),
+//                        one packet every interval while on
+//   trace:<file>         "time(s) size(bytes)" per line, times from the start
+//
+#ifndef LY_TRAFFIC_SENDER_H
+#define LY_TRAFFIC_SENDER_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/abort.h"
+#include "ns3/application.h"
+#include "ns3/double.h"
+#include "ns3/event-id.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/simulator.h"
+#include "ns3/socket.h"
+#include "ns3/traced-callback.h"
+#include "ns3/uinteger.h"
+#include "ns3/udp-socket-factory.h"
+#include "ns3/temp.h"
+
+#include "packet-pool.h"
+
+namespace ns3 {
+
+/**
+ * One packet to send, relative to the start of the application.
+ */
+struct TrafficArrival
+{
+  Time at;
+  uint32_t size;
+};
+
+/**
+ * Source of packet arrivals.
+ */
+class TrafficGenerator : public SimpleRefCount<TrafficGenerator>
+{
+public:
+  virtual ~TrafficGenerator ()
+  {
+  }
+
+  /**
+   * Append up to max arrivals following the previous ones.
+   * \param batch arrivals in increasing time order
+   * \param max arrivals wanted
+   * \return false when the source has no arrivals left
+   */
+  virtual bool Generate (std::vector<TrafficArrival> &batch, uint32_t max) = 0;
+};
+
+class CbrTrafficGenerator : public TrafficGenerator
+{
+public:
+  CbrTrafficGenerator (Time interval, uint32_t size)
+    : m_interval (interval),
+      m_size (size),
+      m_n (0)
+  {
+  }
+
+  virtual bool Generate (std::vector<TrafficArrival> &batch, uint32_t max)
+  {
+    for (uint32_t k = 0; k < max; ++k, ++m_n)
+      {
+        TrafficArrival arrival = { Time (m_interval.GetTimeStep () * static_cast<int64_t> (m_n)), m_size };
+        batch.push_back (arrival);
+      }
+    return true;
+  }
+
+private:
+  Time m_interval;
+  uint32_t m_size;
+  uint64_t m_n;
+};
+
+class PoissonTrafficGenerator : public TrafficGenerator
+{
+public:
+  PoissonTrafficGenerator (Time interval, uint32_t size)
+    : m_size (size),
+      m_gap (CreateObject<ExponentialRandomVariable> ())
+  {
+    m_gap->SetAttribute ("Mean", DoubleValue (interval.GetSeconds ()));
+  }
+
+  virtual bool Generate (std::vector<TrafficArrival> &batch, uint32_t max)
+  {
+    for (uint32_t k = 0; k < max; ++k)
+      {
+        TrafficArrival arrival = { m_last, m_size };
+        batch.push_back (arrival);
+        m_last += Seconds (m_gap->GetValue ());
+      }
+    return true;
+  }
+
+private:
+  uint32_t m_size;
+  Time m_last;
+  Ptr<ExponentialRandomVariable> m_gap;
+};
+
+class OnOffTrafficGenerator : public TrafficGenerator
+{
+public:
+  OnOffTrafficGenerator (Time interval, uint32_t size, double onMean, double offMean)
+    : m_interval (interval),
+      m_size (size),
+      m_on (CreateObject<ExponentialRandomVariable> ()),
+      m_off (CreateObject<ExponentialRandomVariable> ())
+  {
+    NS_ABORT_MSG_IF (!interval.IsStrictlyPositive () || onMean <= 0 || offMean < 0,
+                     "On/off traffic needs a positive interval and on period");
+    m_on->SetAttribute ("Mean", DoubleValue (onMean));
+    m_off->SetAttribute ("Mean", DoubleValue (offMean));
+    m_burstEnd = Seconds (m_on->GetValue ());
+  }
+
+  virtual bool Generate (std::vector<TrafficArrival> &batch, uint32_t max)
+  {
+    for (uint32_t k = 0; k < max; ++k)
+      {
+        while (m_next >= m_burstEnd)
+          {
+            // the off period starts where the burst ended
+            m_next = m_burstEnd + Seconds (m_off->GetValue ());
+            m_burstEnd = m_next + Seconds (m_on->GetValue ());
+          }
+        TrafficArrival arrival = { m_next, m_size };
+        batch.push_back (arrival);
+        m_next += m_interval;
+      }
+    return true;
+  }
+
+private:
+  Time m_interval;
+  uint32_t m_size;
+  Time m_next;
+  Time m_burstEnd;
+  Ptr<ExponentialRandomVariable> m_on;
+  Ptr<ExponentialRandomVariable> m_off;
+};
+
+class TraceTrafficGenerator : public TrafficGenerator
+{
+public:
+  explicit TraceTrafficGenerator (std::string fileName)
+    : m_in (fileName.c_str ()),
+      m_fileName (fileName),
+      m_lineNo (0)
+  {
+    NS_ABORT_MSG_IF (!m_in, "Cannot open traffic trace " << fileName);
+  }
+
+  virtual bool Generate (std::vector<TrafficArrival> &batch, uint32_t max)
+  {
+    std::string line;
+    uint32_t added = 0;
+    while (added < max && std::getline (m_in, line))
+      {
+        ++m_lineNo;
+        std::string::size_type hash = line.find ('#');
+        if (hash != std::string::npos)
+          {
+            line.erase (hash);
+          }
+        std::istringstream fields (line);
+        double at;
+        uint32_t size;
+        if (!(fields >> at))
+          {
+            continue;
+          }
+        NS_ABORT_MSG_IF (!(fields >> size), m_fileName << ":" << m_lineNo << ": expected time size");
+        TrafficArrival arrival = { Seconds (at), size };
+        NS_ABORT_MSG_IF (arrival.at < m_last, m_fileName << ":" << m_lineNo << ": time goes backwards");
+        m_last = arrival.at;
+        batch.push_back (arrival);
+        ++added;
+      }
+    return added > 0;
+  }
+
+private:
+  std::ifstream m_in;
+  std::string m_fileName;
+  uint32_t m_lineNo;
+  Time m_last;
+};
+
+/**
+ * \param spec cbr, poisson, onoff:<on>:<off> or trace:<file>
+ * \param interval packet interval of the flow
+ * \param size packet size of the flow
+ */
+Ptr<TrafficGenerator>
+CreateTrafficGenerator (std::string spec, Time interval, uint32_t size)
+{
+  if (spec == "cbr")
+    {
+      return Create<CbrTrafficGenerator> (interval, size);
+    }
+  if (spec == "poisson")
+    {
+      return Create<PoissonTrafficGenerator> (interval, size);
+    }
+  if (spec.compare (0, 6, "onoff:") == 0)
+    {
+      std::string::size_type colon = spec.find (':', 6);
+      NS_ABORT_MSG_IF (colon == std::string::npos, "Expected onoff:<on>:<off>, got " << spec);
+      return Create<OnOffTrafficGenerator> (interval, size,
+                                            std::atof (spec.c_str () + 6),
+                                            std::atof (spec.c_str () + colon + 1));
+    }
+  if (spec.compare (0, 6, "trace:") == 0)
+    {
+      return Create<TraceTrafficGenerator> (spec.substr (6));
+    }
+  NS_ABORT_MSG ("Unknown traffic generator " << spec);
+  return 0;
+}
+
+class TrafficSender;
+
+/**
+ * One simulator event for the next arrivals of many TrafficSenders.
+ */
+class TrafficDispatcher : public SimpleRefCount<TrafficDispatcher>
+{
+public:
+  TrafficDispatcher ();
+  ~TrafficDispatcher ();
+
+  /**
+   * Let the sender send at the given time.
+   * \param sender the sender
+   * \param at absolute time, not in the past
+   * \return ticket of the arrival; the sender is only called if its
+   *         ticket still matches then
+   */
+  uint64_t Add (Ptr<TrafficSender> sender, Time at);
+
+  /// \return arrivals waiting in the heap, including cancelled ones
+  uint32_t GetPending (void) const;
+
+private:
+  struct Pending
+  {
+    Time at;
+    uint64_t ticket;             //!< also breaks ties in filing order
+    Ptr<TrafficSender> sender;
+  };
+  /// orders the heap by earliest time first
+  struct Later
+  {
+    bool operator() (const Pending &a, const Pending &b) const
+    {
+      return a.at != b.at ? a.at > b.at : a.ticket > b.ticket;
+    }
+  };
+
+  void Arm (void);
+  void Fire (void);
+
+  std::vector<Pending> m_heap;
+  uint64_t m_tickets;
+  EventId m_event;
+  Time m_armedAt;
+  bool m_firing;                 //!< Fire() re-arms once at the end
+};
+
+/**
+ * Sends the arrivals of a TrafficGenerator to one UDP destination.
+ */
+class TrafficSender : public Application
+{
+public:
+  static TypeId GetTypeId (void);
+
+  TrafficSender ();
+  virtual ~TrafficSender ();
+
+  void SetGenerator (Ptr<TrafficGenerator> generator);
+  /// \param pool pool to take the packets from, 0 to allocate them
+  void SetPacketPool (Ptr<PacketPool> pool);
+  /// \param dispatcher dispatcher shared with other senders, 0 to
+  ///        schedule one event per arrival
+  void SetDispatcher (Ptr<TrafficDispatcher> dispatcher);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  friend class TrafficDispatcher;
+
+  virtual void StartApplication (void);
+  virtual void StopApplication (void);
+
+  void Refill (void);
+  void ScheduleNext (void);
+  void Send (void);
+
+  Ipv4Address m_destAddr;
+  uint32_t m_destPort;
+  uint32_t m_numPkts;            //!< packets to send, 0 = no limit
+  uint32_t m_batchSize;
+
+  Ptr<TrafficGenerator> m_generator;
+  Ptr<PacketPool> m_pool;
+  Ptr<TrafficDispatcher> m_dispatcher;
+  uint64_t m_ticket;             //!< arrival filed with m_dispatcher, 0 = none
+  std::vector<TrafficArrival> m_batch;
+  uint32_t m_next;               //!< next arrival in m_batch
+  bool m_exhausted;              //!< the generator has nothing left
+  Time m_origin;                 //!< arrival times count from here
+  uint32_t m_count;
+
+  Ptr<Socket> m_socket;
+  EventId m_sendEvent;
+
+  TracedCallback<Ptr<const Packet> > m_txTrace;
+};
+
+TrafficDispatcher::TrafficDispatcher ()
+  : m_tickets (0),
+    m_firing (false)
+{
+}
+
+TrafficDispatcher::~TrafficDispatcher ()
+{
+  m_event.Cancel ();
+}
+
+uint64_t
+TrafficDispatcher::Add (Ptr<TrafficSender> sender, Time at)
+{
+  Pending pending = { at, ++m_tickets, sender };
+  m_heap.push_back (pending);
+  std::push_heap (m_heap.begin (), m_heap.end (), Later ());
+  Arm ();
+  return pending.ticket;
+}
+
+uint32_t
+TrafficDispatcher::GetPending (void) const
+{
+  return m_heap.size ();
+}
+
+void
+TrafficDispatcher::Arm (void)
+{
+  if (m_firing)
+    {
+      return;
+    }
+  if (m_heap.empty ())
+    {
+      m_event.Cancel ();
+      return;
+    }
+  Time at = m_heap.front ().at;
+  if (m_event.IsRunning () && m_armedAt <= at)
+    {
+      return;
+    }
+  m_event.Cancel ();
+  m_armedAt = at;
+  m_event = Simulator::Schedule (at - Simulator::Now (), &TrafficDispatcher::Fire, this);
+}
+
+void
+TrafficDispatcher::Fire (void)
+{
+  Time now = Simulator::Now ();
+  m_firing = true;
+  while (!m_heap.empty () && m_heap.front ().at <= now)
+    {
+      std::pop_heap (m_heap.begin (), m_heap.end (), Later ());
+      Pending due = m_heap.back ();
+      m_heap.pop_back ();
+      if (due.ticket == due.sender->m_ticket)
+        {
+          due.sender->m_ticket = 0;
+          due.sender->Send ();   // files the sender's next arrival
+        }
+    }
+  m_firing = false;
+  Arm ();
+}
+
+TypeId
+TrafficSender::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TrafficSender")
+    .SetParent<Application> ()
+    .AddConstructor<TrafficSender> ()
+    .AddAttribute ("Destination", "Target host address.",
+                   Ipv4AddressValue ("255.255.255.255"),
+                   MakeIpv4AddressAccessor (&TrafficSender::m_destAddr),
+                   MakeIpv4AddressChecker ())
+    .AddAttribute ("Port", "Destination app port.",
+                   UintegerValue (1603),
+                   MakeUintegerAccessor (&TrafficSender::m_destPort),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("NumPackets", "Total number of packets to send, 0 for no limit.",
+                   UintegerValue (30),
+                   MakeUintegerAccessor (&TrafficSender::m_numPkts),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Batch", "Arrivals taken from the generator at a time.",
+                   UintegerValue (64),
+                   MakeUintegerAccessor (&TrafficSender::m_batchSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddTraceSource ("Tx", "A new packet is created and is sent",
+                     MakeTraceSourceAccessor (&TrafficSender::m_txTrace),
+                     "ns3::Packet::TracedCallback")
+  ;
+  return tid;
+}
+
+TrafficSender::TrafficSender ()
+  : m_ticket (0),
+    m_next (0),
+    m_exhausted (false),
+    m_count (0)
+{
+}
+
+TrafficSender::~TrafficSender ()
+{
+}
+
+void
+TrafficSender::SetGenerator (Ptr<TrafficGenerator> generator)
+{
+  m_generator = generator;
+}
+
+void
+TrafficSender::SetPacketPool (Ptr<PacketPool> pool)
+{
+  m_pool = pool;
+}
+
+void
+TrafficSender::SetDispatcher (Ptr<TrafficDispatcher> dispatcher)
+{
+  m_dispatcher = dispatcher;
+}
+
+void
+TrafficSender::DoDispose (void)
+{
+  m_socket = 0;
+  m_generator = 0;
+  m_pool = 0;
+  m_dispatcher = 0;
+  m_ticket = 0;
+  Application::DoDispose ();
+}
+
+void
+TrafficSender::StartApplication (void)
+{
+  NS_ABORT_MSG_IF (m_generator == 0, "TrafficSender without a generator");
+  if (m_socket == 0)
+    {
+      m_socket = Socket::CreateSocket (GetNode (), UdpSocketFactory::GetTypeId ());
+      m_socket->Bind ();
+    }
+  m_batch.reserve (m_batchSize);
+  m_origin = Simulator::Now ();
+  m_count = 0;
+  Refill ();
+  ScheduleNext ();
+}
+
+void
+TrafficSender::StopApplication (void)
+{
+  Simulator::Cancel (m_sendEvent);
+  m_ticket = 0;   // the dispatcher drops the filed arrival
+}
+
+void
+TrafficSender::Refill (void)
+{
+  m_batch.clear ();
+  m_next = 0;
+  if (!m_exhausted)
+    {
+      m_exhausted = !m_generator->Generate (m_batch, m_batchSize);
+    }
+}
+
+void
+TrafficSender::ScheduleNext (void)
+{
+  if (m_next == m_batch.size () || (m_numPkts != 0 && m_count >= m_numPkts))
+    {
+      return;
+    }
+  Time at = m_origin + m_batch[m_next].at;
+  if (m_dispatcher != 0)
+    {
+      m_ticket = m_dispatcher->Add (this, std::max (at, Simulator::Now ()));
+      return;
+    }
+  m_sendEvent = Simulator::Schedule (at > Simulator::Now () ? at - Simulator::Now () : Time (0),
+                                     &TrafficSender::Send, this);
+}
+
+void
+TrafficSender::Send (void)
+{
+  Time now = Simulator::Now ();
+  while (m_next < m_batch.size () && m_origin + m_batch[m_next].at <= now
+         && (m_numPkts == 0 || m_count < m_numPkts))
+    {
+      uint32_t size = m_batch[m_next].size;
+      Ptr<Packet> packet = m_pool != 0 ? m_pool->Get (size) : Create<Packet> (size);
+      TimestampTag timestamp;
+      timestamp.SetTimestamp (now);
+      packet->AddByteTag (timestamp);
+      m_socket->SendTo (packet, 0, InetSocketAddress (m_destAddr, m_destPort));
+      m_txTrace (packet);
+      ++m_count;
+      ++m_next;
+      if (m_next == m_batch.size ())
+        {
+          Refill ();
+        }
+    }
+  ScheduleNext ();
+}
+
+} // namespace ns3
+
+#endif /* LY_TRAFFIC_SENDER_H */
@@ -0,0 +1,194 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Shared routing warm-up for several replications.
+//
+// The scenario runs until the warm-up time, then Fork() duplicates the
+// process once per replication.  Every child inherits the converged
+// routing tables, neighbor sets, MAC state and the pending events
+// exactly as they are, continues from the warm-up time with
+// RngRun = baseRun + child index, and installs its own traffic.  The
+// parent only waits for the children, at most "jobs" of them at a time.
+//
+// Random streams created after the fork (flow generation, the
+// applications) draw from the child's run; those created before it
+// (OLSR jitter, the MAC backoff) continue from the shared warm-up state,
+// the same as if the state had been restored from a file.
+//
+// ns-3 objects cannot be serialized, so the checkpoint is the forked
+// address space and not a file: it lives only as long as the parent.
+//
+#ifndef LY_WARMUP_FORK_H
+#define LY_WARMUP_FORK_H
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/rng-seed-manager.h"
+
+namespace ns3 {
+
+class WarmupFork
+{
+public:
+  WarmupFork ();
+
+  /// \param forks replications continuing from the warm-up state
+  void SetForks (uint32_t forks);
+  /// \param jobs children running at a time, 0 = one per core
+  void SetJobs (uint32_t jobs);
+  void SetBaseRun (uint64_t run);
+  /**
+   * \param prefix output prefix; child k logs to <prefix>-f<k>.log
+   */
+  void SetPrefix (std::string prefix);
+
+  /**
+   * Fork the replications.  In a child, returns its index after setting
+   * its RngRun; in the parent, returns -1 once every child has exited.
+   */
+  int Fork (void);
+  /// \return children that did not exit with status 0
+  uint32_t GetFailed (void) const;
+
+private:
+  uint32_t m_forks;
+  uint32_t m_jobs;
+  uint64_t m_baseRun;
+  std::string m_prefix;
+  uint32_t m_failed;
+};
+
+WarmupFork::WarmupFork ()
+  : m_forks (1),
+    m_jobs (0),
+    m_baseRun (1),
+    m_prefix ("data"),
+    m_failed (0)
+{
+}
+
+void
+WarmupFork::SetForks (uint32_t forks)
+{
+  NS_ABORT_MSG_IF (forks == 0, "At least one replication must follow the warm-up");
+  m_forks = forks;
+}
+
+void
+WarmupFork::SetJobs (uint32_t jobs)
+{
+  m_jobs = jobs;
+}
+
+void
+WarmupFork::SetBaseRun (uint64_t run)
+{
+  m_baseRun = run;
+}
+
+void
+WarmupFork::SetPrefix (std::string prefix)
+{
+  m_prefix = prefix;
+}
+
+uint32_t
+WarmupFork::GetFailed (void) const
+{
+  return m_failed;
+}
+
+int
+WarmupFork::Fork (void)
+{
+  uint32_t jobs = m_jobs;
+  if (jobs == 0)
+    {
+      long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+      jobs = cpus > 0 ? cpus : 1;
+    }
+  // buffered output would otherwise be written once per child
+  std::fflush (0);
+
+  std::map<pid_t, uint32_t> running;
+  uint32_t next = 0;
+  m_failed = 0;
+  while (next < m_forks || !running.empty ())
+    {
+      while (next < m_forks && running.size () < jobs)
+        {
+          pid_t pid = fork ();
+          NS_ABORT_MSG_IF (pid < 0, "fork failed: " << std::strerror (errno));
+          if (pid == 0)
+            {
+              std::ostringstream name;
+              name << m_prefix << "-f" << next << ".log";
+              int log = open (name.str ().c_str (), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+              if (log >= 0)
+                {
+                  dup2 (log, STDOUT_FILENO);
+                  dup2 (log, STDERR_FILENO);
+                  close (log);
+                }
+              RngSeedManager::SetRun (m_baseRun + next);
+              return next;
+            }
+          running[pid] = next;
+          ++next;
+        }
+      int status;
+      pid_t pid = waitpid (-1, &status, 0);
+      if (pid < 0)
+        {
+          NS_ABORT_MSG_IF (errno != EINTR, "waitpid failed: " << std::strerror (errno));
+          continue;
+        }
+      std::map<pid_t, uint32_t>::iterator it = running.find (pid);
+      if (it == running.end ())
+        {
+          continue;
+        }
+      if (WIFEXITED (status) && WEXITSTATUS (status) == 0)
+        {
+          NS_LOG_UNCOND ("Warm-up: replication " << it->second << " finished");
+        }
+      else
+        {
+          ++m_failed;
+          NS_LOG_UNCOND ("Warm-up: replication " << it->second << " failed, see "
+                         << m_prefix << "-f" << it->second << ".log");
+        }
+      running.erase (it);
+    }
+  return -1;
+}
+
+} // namespace ns3
+
+#endif /* LY_WARMUP_FORK_H */